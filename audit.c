@@ -0,0 +1,186 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "audit.h"
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <xcb/xcb.h>
+
+#define AUDIT_SITES_SIZE 64
+
+typedef struct
+{
+    const char *file;
+    int line;
+    uint_fast32_t count;
+    uint_fast32_t hot; // Round trips made while handling a hot event
+    uint_fast64_t total;
+    uint_fast64_t max;
+    uint8_t event; // Event being handled during the last wait
+} audit_site;
+
+static audit_site sites[AUDIT_SITES_SIZE];
+static uint_fast8_t sites_length = 0;
+
+static uint8_t event_type = 0; // 0 when no event is being handled
+static struct timespec start;
+static volatile sig_atomic_t dump_requested = 0;
+
+static const char *event_name(uint8_t type)
+{
+    switch (type)
+    {
+    case 0:
+        return "none";
+    case XCB_KEY_PRESS:
+        return "KEY_PRESS";
+    case XCB_BUTTON_PRESS:
+        return "BUTTON_PRESS";
+    case XCB_BUTTON_RELEASE:
+        return "BUTTON_RELEASE";
+    case XCB_MOTION_NOTIFY:
+        return "MOTION_NOTIFY";
+    case XCB_DESTROY_NOTIFY:
+        return "DESTROY_NOTIFY";
+    case XCB_UNMAP_NOTIFY:
+        return "UNMAP_NOTIFY";
+    case XCB_MAP_REQUEST:
+        return "MAP_REQUEST";
+    case XCB_CONFIGURE_REQUEST:
+        return "CONFIGURE_REQUEST";
+    default:
+        return "other";
+    }
+}
+
+static bool event_hot(uint8_t type)
+{
+    return type == XCB_KEY_PRESS || type == XCB_MOTION_NOTIFY || type == XCB_CONFIGURE_REQUEST;
+}
+
+static void audit_dump()
+{
+    printf("=======[ audit: round trips ]=======\n");
+    printf("%-24s %8s %8s %12s %10s  %s\n", "call site", "count", "hot", "total (us)", "max (us)",
+           "last event");
+
+    for (uint_fast8_t i = 0; i != sites_length; i++)
+    {
+        char site[64];
+        snprintf(site, sizeof(site), "%s:%d", sites[i].file, sites[i].line);
+        printf("%-24s %8lu %8lu %12lu %10lu  %s\n", site, (unsigned long)sites[i].count,
+               (unsigned long)sites[i].hot, (unsigned long)(sites[i].total / 1000),
+               (unsigned long)(sites[i].max / 1000), event_name(sites[i].event));
+    }
+
+    fflush(stdout);
+}
+
+static void handle_sigusr1(__attribute__((unused)) int signal)
+{
+    dump_requested = 1;
+}
+
+void audit_setup()
+{
+    struct sigaction action = {.sa_handler = handle_sigusr1};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+void audit_event_begin(uint8_t type)
+{
+    event_type = type;
+}
+
+void audit_event_end()
+{
+    event_type = 0;
+}
+
+// Print the summary if it was requested, the signal handler itself can't do it safely
+void audit_poll()
+{
+    if (!dump_requested)
+        return; // Nothing to be done
+
+    dump_requested = 0;
+    audit_dump();
+}
+
+void audit_begin()
+{
+    clock_gettime(CLOCK_MONOTONIC, &start);
+}
+
+static void audit_record(const char *file, int line)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint_fast64_t wait = (end.tv_sec - start.tv_sec) * 1000000000 + end.tv_nsec - start.tv_nsec;
+
+    audit_site *site = NULL;
+    for (uint_fast8_t i = 0; i != sites_length; i++)
+    {
+        if (sites[i].line == line && sites[i].file == file)
+        {
+            site = &sites[i];
+            break;
+        }
+    }
+
+    if (site == NULL)
+    {
+        // Too many call sites, the summary won't be complete
+        if (sites_length == AUDIT_SITES_SIZE)
+            return;
+
+        site = &sites[sites_length++];
+        *site = (audit_site){.file = file, .line = line};
+    }
+
+    site->count++;
+    site->event = event_type;
+    site->total += wait;
+    if (wait > site->max)
+        site->max = wait;
+
+    if (event_hot(event_type))
+    {
+        site->hot++;
+        printf("audit: round trip in hot handler %s at %s:%d (%lu us)\n", event_name(event_type),
+               file, line, (unsigned long)(wait / 1000));
+    }
+}
+
+void *audit_end(const char *file, int line, void *reply)
+{
+    audit_record(file, line);
+    return reply;
+}
+
+uint32_t audit_end_value(const char *file, int line, uint32_t reply)
+{
+    audit_record(file, line);
+    return reply;
+}
@@ -0,0 +1,59 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "probes.h"
+
+/*
+ * Round trip auditor, only compiled in debug builds (make debug)
+ *
+ * Every blocking wait for a reply goes through AUDIT_REPLY, which records the call site, the time
+ * spent waiting and the event being handled. Round trips made while handling a hot event (key
+ * press, motion, configure request) are reported right away. The summary is printed on SIGUSR1.
+ */
+
+#ifdef AUDIT
+
+#include <stdint.h>
+
+void audit_setup();
+void audit_event_begin(uint8_t);
+void audit_event_end();
+void audit_poll();
+void audit_begin();
+void *audit_end(const char *, int, void *);
+uint32_t audit_end_value(const char *, int, uint32_t);
+
+// For replies returned as a pointer
+#define AUDIT_REPLY(reply) audit_end(__FILE__, __LINE__, (audit_begin(), PROBE_REPLY(reply)))
+// For replies returned as a value (status, keysym)
+#define AUDIT_REPLY_VALUE(reply)                                                                   \
+    audit_end_value(__FILE__, __LINE__, (audit_begin(), PROBE_REPLY_VALUE(reply)))
+
+#else
+
+#define audit_setup()
+#define audit_event_begin(type)
+#define audit_event_end()
+#define audit_poll()
+// Still seen by the probes (probes.h)
+#define AUDIT_REPLY(reply) PROBE_REPLY(reply)
+#define AUDIT_REPLY_VALUE(reply) PROBE_REPLY_VALUE(reply)
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bar.h"
+#include "audit.h"
+#include "client.h"
+#include "kbgwm.h"
+#include "xcbutils.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcbext.h>
+
+#define BAR_TEXT_SIZE 256
+#define BAR_PADDING 4
+
+typedef struct
+{
+    int16_t x;
+    uint16_t width;
+    uint32_t foreground, background;
+    bool marker; // Small square in the corner, for occupied workspaces
+    char text[BAR_TEXT_SIZE];
+} cell;
+
+// Workspaces, then the title and the status
+#define BAR_WORKSPACES_MAX 64 // WORKSPACES_MAX can not go higher
+#define BAR_CELLS_SIZE (BAR_WORKSPACES_MAX + 2)
+
+xcb_window_t bar_window = XCB_NONE;
+uint16_t bar_height = 0;
+
+static xcb_pixmap_t pixmap;
+static xcb_gcontext_t gc;
+static uint16_t font_width;
+static int16_t font_ascent;
+
+// What is on the pixmap, what should be there
+static cell drawn[BAR_CELLS_SIZE];
+static cell wanted[BAR_CELLS_SIZE];
+static uint_fast8_t drawn_length = 0;
+
+static char title[BAR_TEXT_SIZE];
+static char status[BAR_TEXT_SIZE];
+static xcb_window_t title_window = XCB_NONE;
+
+// Replies waited for without blocking, 0 when none
+static unsigned int title_sequence = 0;
+static unsigned int title_utf8_sequence = 0;
+static unsigned int status_sequence = 0;
+
+void setup_bar()
+{
+    if (!bar_enabled)
+        return; // Nothing to be done
+
+    xcb_font_t font = xcb_generate_id(c);
+    xcb_open_font(c, font, strlen(bar_font), bar_font);
+
+    xcb_query_font_reply_t *metrics =
+        AUDIT_REPLY(xcb_query_font_reply(c, xcb_query_font(c, font), NULL));
+    if (metrics == NULL)
+    {
+        printf("setup_bar: unable to open the font %s\n", bar_font);
+        return;
+    }
+
+    font_width = metrics->max_bounds.character_width;
+    font_ascent = metrics->font_ascent;
+    bar_height = metrics->font_ascent + metrics->font_descent + 2;
+    free(metrics);
+
+    bar_window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, bar_window, root, 0, 0, screen->width_in_pixels,
+                      bar_height, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_BACK_PIXMAP | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK,
+                      (uint32_t[]){XCB_BACK_PIXMAP_NONE, 1, XCB_EVENT_MASK_EXPOSURE});
+
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, screen->root_depth, pixmap, bar_window, screen->width_in_pixels,
+                      bar_height);
+
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, pixmap, XCB_GC_FONT | XCB_GC_GRAPHICS_EXPOSURES, (uint32_t[]){font, 0});
+    xcb_close_font(c, font);
+
+    xcb_rectangle_t all = {0, 0, screen->width_in_pixels, bar_height};
+    xcb_change_gc(c, gc, XCB_GC_FOREGROUND, (uint32_t[]){bar_background});
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &all);
+
+    xcb_map_window(c, bar_window);
+    bar_property(root, XCB_ATOM_WM_NAME);
+}
+
+// Only what the font can display
+static void bar_copy_text(char *destination, const char *source, int length)
+{
+    if (length > BAR_TEXT_SIZE - 1)
+        length = BAR_TEXT_SIZE - 1;
+
+    for (int i = 0; i != length; i++)
+        destination[i] = source[i] >= ' ' && source[i] <= '~' ? source[i] : '?';
+    destination[length] = '\0';
+}
+
+// Take a reply if it has arrived, returns false while it is still on its way
+static bool bar_reply(unsigned int *sequence, char *text)
+{
+    if (*sequence == 0)
+        return false;
+
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+    if (!xcb_poll_for_reply(c, *sequence, &reply, &error))
+        return false;
+
+    *sequence = 0;
+    free(error);
+
+    xcb_get_property_reply_t *property = reply;
+    if (property == NULL || xcb_get_property_value_length(property) == 0)
+    {
+        free(property);
+        return false;
+    }
+
+    bar_copy_text(text, xcb_get_property_value(property), xcb_get_property_value_length(property));
+    free(property);
+    return true;
+}
+
+static unsigned int bar_fetch(xcb_window_t window, xcb_atom_t atom, unsigned int previous)
+{
+    if (previous != 0)
+        xcb_discard_reply(c, previous);
+
+    return xcb_get_property(c, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, BAR_TEXT_SIZE / 4)
+        .sequence;
+}
+
+// A property shown in the bar changed, fetch it without waiting for the reply
+void bar_property(xcb_window_t window, xcb_atom_t atom)
+{
+    if (bar_window == XCB_NONE)
+        return; // Nothing to be done
+
+    if (window == root && atom == XCB_ATOM_WM_NAME)
+        status_sequence = bar_fetch(root, XCB_ATOM_WM_NAME, status_sequence);
+    else if (window == title_window && atom == XCB_ATOM_WM_NAME)
+        title_sequence = bar_fetch(window, XCB_ATOM_WM_NAME, title_sequence);
+    else if (window == title_window && atom == net_wm_name && net_wm_name != XCB_NONE)
+        title_utf8_sequence = bar_fetch(window, net_wm_name, title_utf8_sequence);
+}
+
+static uint16_t text_width(const char *text)
+{
+    return strlen(text) * font_width + 2 * BAR_PADDING;
+}
+
+static bool cell_equal(const cell *a, const cell *b)
+{
+    return a->x == b->x && a->width == b->width && a->foreground == b->foreground &&
+           a->background == b->background && a->marker == b->marker &&
+           strcmp(a->text, b->text) == 0;
+}
+
+static void cell_draw(const cell *cell)
+{
+    xcb_rectangle_t area = {cell->x, 0, cell->width, bar_height};
+    xcb_change_gc(c, gc, XCB_GC_FOREGROUND, (uint32_t[]){cell->background});
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &area);
+
+    xcb_change_gc(c, gc, XCB_GC_FOREGROUND | XCB_GC_BACKGROUND,
+                  (uint32_t[]){cell->foreground, cell->background});
+    xcb_image_text_8(c, strlen(cell->text), pixmap, gc, cell->x + BAR_PADDING, font_ascent + 1,
+                     cell->text);
+
+    if (cell->marker)
+        xcb_poly_fill_rectangle(c, pixmap, gc, 1, &(xcb_rectangle_t){cell->x + 1, 1, 3, 3});
+
+    xcb_copy_area(c, pixmap, bar_window, gc, cell->x, 0, cell->x, 0, cell->width, bar_height);
+}
+
+// Called at the end of each event batch, redraws the cells that changed
+void bar_update()
+{
+    if (bar_window == XCB_NONE)
+        return; // Nothing to be done
+
+    // The focused window changed, show its title once it is known
+    xcb_window_t focused = workspaces[current_workspace] ? workspaces[current_workspace]->id : 0;
+    if (focused != title_window)
+    {
+        title_window = focused;
+        title[0] = '\0';
+        if (focused != XCB_NONE)
+        {
+            bar_property(focused, XCB_ATOM_WM_NAME);
+            bar_property(focused, net_wm_name);
+        }
+    }
+
+    // _NET_WM_NAME wins over WM_NAME
+    char name[BAR_TEXT_SIZE];
+    if (bar_reply(&title_utf8_sequence, name))
+    {
+        strcpy(title, name);
+        if (title_sequence != 0)
+            xcb_discard_reply(c, title_sequence);
+        title_sequence = 0;
+    }
+    else if (title_utf8_sequence == 0 && bar_reply(&title_sequence, name))
+        strcpy(title, name);
+
+    bar_reply(&status_sequence, status);
+
+    uint_fast8_t length = 0;
+    int16_t x = 0;
+
+    for (uint_fast8_t i = 0; i != workspaces_length && i != BAR_WORKSPACES_MAX; i++, length++)
+    {
+        cell *cell = &wanted[length];
+        // Numbered like the keys, 0 for the tenth
+        snprintf(cell->text, BAR_TEXT_SIZE, "%d", i < 10 ? (i + 1) % 10 : i + 1);
+        cell->x = x;
+        cell->width = text_width(cell->text);
+        cell->foreground = bar_foreground;
+        cell->background = i == current_workspace ? focus_color : bar_background;
+        cell->marker = workspaces[i] != NULL;
+        x += cell->width;
+    }
+
+    uint16_t status_width = status[0] != '\0' ? text_width(status) : 0;
+    if (status_width > screen->width_in_pixels - x)
+        status_width = screen->width_in_pixels - x;
+
+    cell *title_cell = &wanted[length++];
+    strcpy(title_cell->text, title);
+    title_cell->x = x;
+    title_cell->width = screen->width_in_pixels - x - status_width;
+    title_cell->foreground = bar_foreground;
+    title_cell->background = bar_background;
+    title_cell->marker = false;
+
+    cell *status_cell = &wanted[length++];
+    strcpy(status_cell->text, status);
+    status_cell->x = screen->width_in_pixels - status_width;
+    status_cell->width = status_width;
+    status_cell->foreground = bar_foreground;
+    status_cell->background = bar_background;
+    status_cell->marker = false;
+
+    for (uint_fast8_t i = 0; i != length; i++)
+    {
+        if (i < drawn_length && cell_equal(&drawn[i], &wanted[i]))
+            continue;
+
+        if (wanted[i].width != 0)
+            cell_draw(&wanted[i]);
+        drawn[i] = wanted[i];
+    }
+
+    drawn_length = length;
+}
+
+// The only full repaint: copy what the X server lost from the pixmap
+void bar_expose(xcb_expose_event_t *event)
+{
+    xcb_copy_area(c, pixmap, bar_window, gc, event->x, event->y, event->x, event->y,
+                  event->width, event->height);
+}
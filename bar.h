@@ -0,0 +1,36 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/*
+ * Built-in bar: workspaces, their occupancy, the title of the focused window and a status read
+ * from the WM_NAME of the root window (xsetroot -name). It is drawn into a pixmap one cell at a
+ * time, bar_update() only redraws and copies the cells whose content changed.
+ */
+
+extern xcb_window_t bar_window;
+extern uint16_t bar_height;
+
+void setup_bar();
+void bar_update();
+void bar_expose(xcb_expose_event_t *);
+void bar_property(xcb_window_t, xcb_atom_t);
@@ -0,0 +1,365 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Microbenchmarks of the client and event logic, run against the mock X server.
+ * Every operation has a budget of requests and round trips, exceeding it fails the run.
+ */
+
+#include "../client.h"
+#include "../events.h"
+#include "../kbgwm.h"
+#include "../layout.h"
+#include "../pace.h"
+#include "../props.h"
+#include "../rules.h"
+#include "../xcbutils.h"
+#include "mockxcb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xinput.h>
+
+#define CLIENTS 4000
+#define SWITCHES 100
+#define STORM 8
+#define TOGGLES 10
+#define FRAMES 1000
+
+typedef struct
+{
+    const char *name;
+    void (*setup)();
+    uint_fast32_t (*run)(); // Returns the number of operations done
+    double max_requests;    // Per operation
+    double max_round_trips; // Per operation
+} benchmark;
+
+// Not part of any header, only called by main()
+void setup_keyboard();
+
+static xcb_window_t ids[CLIENTS];
+
+// clang-format off
+static const Rule bench_rules[] = {
+    /* class       instance  role  workspace  x  y  width  height  maximized  focus */
+    { "Gimp",      NULL,     NULL, -1,        0, 0, 0,     0,      true,      true },
+    { "Firefox",   NULL,     NULL, 8,         0, 0, 0,     0,      false,     false },
+};
+// clang-format on
+
+// Forget every client, kbgwm starts over with an empty X server
+static void reset()
+{
+    // Nothing may be left pointing to the clients freed below
+    client_configure_flush();
+
+    for (uint_fast8_t i = 0; i != workspaces_length; i++)
+    {
+        while (workspaces[i] != NULL)
+            free(client_remove_workspace(i));
+        layouts[i] = LAYOUT_FLOATING;
+    }
+
+    current_workspace = 0;
+    mock_reset();
+}
+
+// Every fourth window matches a rule of bench_rules
+static void create_windows()
+{
+    reset();
+
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+    {
+        ids[i] = mock_create_window(i % 1000, i % 700, 640, 480);
+
+        if (i % 4 == 0)
+            mock_set_property(ids[i], XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 8, 10, "gimp\0Gimp\0");
+        else
+            mock_set_property(ids[i], XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 8, 12, "xterm\0XTerm\0");
+    }
+}
+
+static void create_clients()
+{
+    create_windows();
+
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+        client_create(ids[i]);
+
+    props_poll();
+}
+
+// Half of the clients on workspace 0, the other half on workspace 1
+static void create_clients_two_workspaces()
+{
+    create_windows();
+
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+    {
+        current_workspace = i < CLIENTS / 2 ? 0 : 1;
+        client_create(ids[i]);
+        props_poll();
+    }
+
+    current_workspace = 0;
+}
+
+static uint_fast32_t run_client_create()
+{
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+        client_create(ids[i]);
+
+    // Without the worker, the properties are fetched at the end of the event batch, the
+    // configures of the windows placed then are sent right after
+    props_poll();
+    client_configure_flush();
+
+    return CLIENTS;
+}
+
+static uint_fast32_t run_focus_next()
+{
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+        focus_next(&(const Arg){.b = i & 1});
+
+    return CLIENTS;
+}
+
+static uint_fast32_t run_workspace_set()
+{
+    for (uint_fast32_t i = 0; i != SWITCHES; i++)
+        workspace_set(current_workspace == 0 ? 1 : 0);
+
+    return SWITCHES;
+}
+
+// The pointer goes to another client and clicks it
+static uint_fast32_t run_click_focus()
+{
+    uint8_t opcode = xcb_get_extension_data(c, &xcb_input_id)->major_opcode;
+
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+    {
+        xcb_generic_event_t e = {.response_type = XCB_ENTER_NOTIFY};
+        ((xcb_enter_notify_event_t *)&e)->event = ids[i];
+        handle_event(&e);
+
+        xcb_input_raw_button_press_event_t press = {.response_type = XCB_GE_GENERIC,
+                                                    .extension = opcode,
+                                                    .event_type = XCB_INPUT_RAW_BUTTON_PRESS,
+                                                    .detail = XCB_BUTTON_INDEX_1};
+        handle_event((xcb_generic_event_t *)&press);
+    }
+
+    return CLIENTS;
+}
+
+// Every client sends a burst of ConfigureRequests within the same batch
+static uint_fast32_t run_handle_configure_request()
+{
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+    {
+        for (uint_fast32_t j = 0; j != STORM; j++)
+        {
+            xcb_generic_event_t e = {.response_type = XCB_CONFIGURE_REQUEST};
+            xcb_configure_request_event_t *event = (xcb_configure_request_event_t *)&e;
+            event->window = ids[i];
+            event->value_mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+                                XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
+            event->x = j;
+            event->y = j;
+            event->width = 320 + j;
+            event->height = 240 + j;
+            handle_event(&e);
+        }
+    }
+
+    configure_request_flush();
+    client_configure_flush();
+    xcb_flush(c);
+
+    return CLIENTS * STORM;
+}
+
+// Every client asks again for the geometry it already has, as a client in a resize loop does
+static uint_fast32_t run_configure_request_noop()
+{
+    for (uint_fast32_t i = 0; i != CLIENTS; i++)
+    {
+        client *client = client_find_all_workspaces(ids[i]);
+
+        xcb_generic_event_t e = {.response_type = XCB_CONFIGURE_REQUEST};
+        xcb_configure_request_event_t *event = (xcb_configure_request_event_t *)&e;
+        event->window = ids[i];
+        event->value_mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
+                            XCB_CONFIG_WINDOW_HEIGHT;
+        event->x = client->x;
+        event->y = client->y;
+        event->width = client->width;
+        event->height = client->height;
+        handle_event(&e);
+    }
+
+    configure_request_flush();
+    client_configure_flush();
+    xcb_flush(c);
+
+    return CLIENTS;
+}
+
+// The focused client goes to a workspace created for it, until none is left
+static uint_fast32_t run_workspace_send_free()
+{
+    for (uint_fast8_t i = 1; i != workspaces_max; i++)
+        workspace_send_free(NULL);
+
+    return workspaces_max - 1;
+}
+
+// The whole workspace goes from one layout to the other, in a single batch each time
+static uint_fast32_t run_layout()
+{
+    for (uint_fast32_t i = 0; i != TOGGLES; i++)
+    {
+        layout(&(const Arg){.i = i & 1 ? LAYOUT_GRID : LAYOUT_MASTER});
+        layout_flush();
+        client_configure_flush();
+        xcb_flush(c);
+    }
+
+    return TOGGLES;
+}
+
+// The configures and events left by the setup are done with, the focused client is grabbed
+static void create_clients_drag()
+{
+    create_clients();
+    client_configure_flush();
+
+    xcb_generic_event_t *event;
+    while ((event = xcb_poll_for_event(c)) != NULL)
+        free(event);
+
+    mousemove(NULL);
+}
+
+// The focused client is dragged, STORM motions arrive between two frames
+static uint_fast32_t run_drag()
+{
+    for (uint_fast32_t i = 0; i != FRAMES; i++)
+    {
+        for (uint_fast32_t j = 0; j != STORM; j++)
+        {
+            xcb_generic_event_t e = {.response_type = XCB_MOTION_NOTIFY};
+            xcb_motion_notify_event_t *event = (xcb_motion_notify_event_t *)&e;
+            event->root_x = (i * STORM + j) % 1000;
+            event->root_y = (i * STORM + j) % 700;
+            handle_event(&e);
+        }
+
+        // The vblank
+        xcb_generic_event_t *frame = xcb_poll_for_event(c);
+        handle_event(frame);
+        free(frame);
+
+        client_configure_flush();
+        xcb_flush(c);
+    }
+
+    handle_event(&(xcb_generic_event_t){.response_type = XCB_BUTTON_RELEASE});
+    return FRAMES;
+}
+
+static const benchmark benchmarks[] = {
+    // Without the worker, the properties cost a round trip per batch
+    {"client_create", create_windows, run_client_create, 13, 1 + 1.0 / PROPS_BATCH_SIZE},
+    {"focus_next", create_clients, run_focus_next, 4, 0},
+    {"click_focus", create_clients, run_click_focus, 4, 0},
+    {"workspace_set", create_clients_two_workspaces, run_workspace_set, CLIENTS + 4, 0},
+    // One configure per client, the maximized quarter gets a ConfigureNotify per request denied
+    {"handle_configure_request", create_clients, run_handle_configure_request,
+     1.0 / STORM + 1.0 / 4, 0},
+    // Only the synthetic ConfigureNotify, no configure
+    {"configure_request_noop", create_clients, run_configure_request_noop, 1, 0},
+    // Only the unmap
+    {"workspace_send_free", create_clients, run_workspace_send_free, 1, 0},
+    // At most one configure per client
+    {"layout", create_clients, run_layout, CLIENTS, 0},
+    // One NotifyMSC and one configure per frame
+    {"drag", create_clients_drag, run_drag, 2 + 1.0 / FRAMES, 0},
+};
+
+int main(void)
+{
+    bool failed = false;
+
+    // kbgwm logs a lot on stdout, keep it out of the way
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    if (out == NULL || freopen("/dev/null", "w", stdout) == NULL)
+    {
+        perror("bench");
+        return 1;
+    }
+
+    c = xcb_connect(NULL, NULL);
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    root = screen->root;
+    wm_protocols = xcb_get_atom(WM_PROTOCOLS);
+    wm_delete_window = xcb_get_atom(WM_DELETE_WINDOW);
+    wm_window_role = xcb_get_atom(WM_WINDOW_ROLE);
+    rules = bench_rules;
+    rules_length = LENGTH(bench_rules);
+    setup_rules();
+    setup_keyboard();
+    setup_pace();
+    setup_events();
+
+    fprintf(out, "%-26s %12s %12s %12s\n", "benchmark", "ns/op", "requests/op", "trips/op");
+
+    for (uint_fast8_t i = 0; i != LENGTH(benchmarks); i++)
+    {
+        const benchmark *b = &benchmarks[i];
+        struct timespec start, end;
+
+        b->setup();
+        mock_reset_stats();
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint_fast32_t ops = b->run();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ns = ((end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec) / ops;
+        double requests = (double)mock.requests / ops;
+        double round_trips = (double)mock.round_trips / ops;
+        bool over = requests > b->max_requests || round_trips > b->max_round_trips;
+
+        fprintf(out, "%-26s %12.0f %12.3f %12.3f%s\n", b->name, ns, requests, round_trips,
+                over ? "  OVER BUDGET" : "");
+        failed |= over;
+    }
+
+    reset();
+    fclose(out);
+    return failed ? 1 : 0;
+}
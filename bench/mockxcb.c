@@ -0,0 +1,1273 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mockxcb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/composite.h>
+#include <xcb/damage.h>
+#include <xcb/present.h>
+#include <xcb/render.h>
+#include <xcb/xcb_icccm.h>
+#include <xcb/xcb_keysyms.h>
+#include <xcb/xcb_renderutil.h>
+#include <xcb/xcbext.h>
+#include <xcb/xinput.h>
+
+#define MOCK_WINDOW_BASE 0x200000
+#define MOCK_WINDOWS_SIZE 65536
+#define MOCK_EVENTS_SIZE 4096
+#define MOCK_ATOMS_SIZE 256
+#define MOCK_ROOT 0x100
+#define MOCK_IN_FLIGHT_SIZE 4096
+#define MOCK_XINPUT_OPCODE 131
+#define MOCK_RENDER_OPCODE 139
+#define MOCK_COMPOSITE_OPCODE 142
+#define MOCK_DAMAGE_OPCODE 143
+#define MOCK_PRESENT_OPCODE 148
+#define MOCK_DAMAGE_FIRST_EVENT 91
+#define MOCK_VISUAL 0x21
+
+mock_stats mock;
+
+static xcb_atom_t atom(const char *, uint16_t);
+mock_request *mock_requests = NULL;
+size_t mock_requests_length = 0;
+static size_t mock_requests_size = 0;
+
+static mock_window windows[MOCK_WINDOWS_SIZE];
+static uint_fast32_t windows_length = 0;
+
+static xcb_generic_event_t events[MOCK_EVENTS_SIZE];
+static uint_fast32_t events_head = 0;
+static uint_fast32_t events_length = 0;
+
+static char *atoms[MOCK_ATOMS_SIZE];
+static uint_fast32_t atoms_length = 0;
+
+static xcb_keysym_t keycodes[256];
+static uint_fast32_t keycodes_length = 8;
+
+// Last sequence number issued, and last one known to have reached the server
+static unsigned int sequence = 0;
+static unsigned int synced = 0;
+
+// What the latest requests were about, by sequence number, to answer their reply
+typedef struct
+{
+    uint32_t resource; // Window, atom
+    uint32_t detail;   // Property
+} request_target;
+
+static request_target in_flight[MOCK_IN_FLIGHT_SIZE];
+
+static int connection;
+static int second_connection; // Always failing, kbgwm then keeps to a single thread
+static bool connected = false;
+static xcb_screen_t screen = {.root = MOCK_ROOT,
+                              .width_in_pixels = 1920,
+                              .height_in_pixels = 1080,
+                              .root_visual = MOCK_VISUAL,
+                              .root_depth = 24};
+static xcb_setup_t setup = {.roots_len = 1};
+
+/*
+ * Model
+ */
+
+void mock_reset_stats()
+{
+    memset(&mock, 0, sizeof(mock));
+    mock_requests_length = 0;
+}
+
+void mock_reset()
+{
+    mock_reset_stats();
+    for (uint_fast32_t i = 0; i != windows_length; i++)
+        for (uint_fast8_t j = 0; j != MOCK_PROPERTIES_SIZE; j++)
+            free(windows[i].properties[j].value);
+
+    windows_length = 0;
+    events_head = 0;
+    events_length = 0;
+}
+
+xcb_window_t mock_create_window(int16_t x, int16_t y, uint16_t width, uint16_t height)
+{
+    if (windows_length == MOCK_WINDOWS_SIZE)
+    {
+        printf("mock: too many windows\n");
+        exit(1);
+    }
+
+    mock_window *window = &windows[windows_length];
+    memset(window, 0, sizeof(*window));
+    window->id = MOCK_WINDOW_BASE + windows_length++;
+    window->x = x;
+    window->y = y;
+    window->width = width;
+    window->height = height;
+    window->delete_window = true;
+    window->max_width = INT32_MAX;
+    window->max_height = INT32_MAX;
+    return window->id;
+}
+
+void mock_set_property(xcb_window_t id, xcb_atom_t atom, xcb_atom_t type, uint8_t format,
+                       uint32_t length, const void *value)
+{
+    mock_window *window = mock_find_window(id);
+    mock_property *property = NULL;
+
+    for (uint_fast8_t i = 0; i != MOCK_PROPERTIES_SIZE && property == NULL; i++)
+        if (window->properties[i].atom == atom || window->properties[i].atom == XCB_NONE)
+            property = &window->properties[i];
+
+    if (property == NULL)
+    {
+        printf("mock: too many properties\n");
+        exit(1);
+    }
+
+    free(property->value);
+    property->atom = atom;
+    property->type = type;
+    property->format = format;
+    property->length = length;
+    property->value = malloc(length * format / 8 + 1);
+    memcpy(property->value, value, length * format / 8);
+}
+
+static mock_property *find_property(mock_window *window, xcb_atom_t atom)
+{
+    if (window != NULL)
+        for (uint_fast8_t i = 0; i != MOCK_PROPERTIES_SIZE; i++)
+            if (window->properties[i].atom == atom)
+                return &window->properties[i];
+
+    return NULL;
+}
+
+mock_window *mock_find_window(xcb_window_t id)
+{
+    if (id >= MOCK_WINDOW_BASE && id - MOCK_WINDOW_BASE < windows_length &&
+        windows[id - MOCK_WINDOW_BASE].id == id)
+        return &windows[id - MOCK_WINDOW_BASE];
+
+    // Adopted windows keep the ID they had on another X server
+    for (uint_fast32_t i = 0; i != windows_length; i++)
+        if (windows[i].id == id)
+            return &windows[i];
+
+    return NULL;
+}
+
+// Create a window with an ID of its own, like the windows of a recorded event log
+void mock_adopt_window(xcb_window_t id, int16_t x, int16_t y, uint16_t width, uint16_t height)
+{
+    if (mock_find_window(id) != NULL)
+        return; // Nothing to be done
+
+    mock_find_window(mock_create_window(x, y, width, height))->id = id;
+}
+
+void mock_queue_event(const void *event)
+{
+    if (events_length == MOCK_EVENTS_SIZE)
+    {
+        printf("mock: too many events\n");
+        exit(1);
+    }
+
+    memcpy(&events[(events_head + events_length++) % MOCK_EVENTS_SIZE], event, 32);
+}
+
+static unsigned int request(uint8_t opcode, xcb_window_t window)
+{
+    if (mock_requests_length == mock_requests_size)
+    {
+        mock_requests_size = mock_requests_size == 0 ? 1024 : mock_requests_size * 2;
+        mock_requests = realloc(mock_requests, mock_requests_size * sizeof(mock_request));
+    }
+
+    mock_requests[mock_requests_length++] = (mock_request){opcode, window};
+    mock.requests++;
+    mock.by_opcode[opcode]++;
+    in_flight[++sequence % MOCK_IN_FLIGHT_SIZE] = (request_target){window, XCB_NONE};
+    return sequence;
+}
+
+static xcb_void_cookie_t void_request(uint8_t opcode, xcb_window_t window)
+{
+    return (xcb_void_cookie_t){request(opcode, window)};
+}
+
+// Waiting for a reply flushes the output buffer and blocks until the server has answered
+static request_target wait_reply(unsigned int cookie)
+{
+    if (cookie > synced)
+    {
+        mock.round_trips++;
+        synced = sequence;
+    }
+
+    return in_flight[cookie % MOCK_IN_FLIGHT_SIZE];
+}
+
+// Atoms are numbered in the order they are first interned, after the predefined ones
+xcb_atom_t mock_atom(const char *name)
+{
+    return atom(name, strlen(name));
+}
+
+static xcb_atom_t atom(const char *name, uint16_t name_len)
+{
+    for (uint_fast32_t i = 0; i != atoms_length; i++)
+        if (strlen(atoms[i]) == name_len && memcmp(atoms[i], name, name_len) == 0)
+            return XCB_ATOM_WM_TRANSIENT_FOR + 1 + i;
+
+    if (atoms_length == MOCK_ATOMS_SIZE)
+    {
+        printf("mock: too many atoms\n");
+        exit(1);
+    }
+
+    atoms[atoms_length] = calloc(1, name_len + 1);
+    memcpy(atoms[atoms_length], name, name_len);
+    return XCB_ATOM_WM_TRANSIENT_FOR + 1 + atoms_length++;
+}
+
+/*
+ * Connection
+ */
+
+xcb_connection_t *xcb_connect(__attribute__((unused)) const char *displayname, int *screenp)
+{
+    if (screenp != NULL)
+        *screenp = 0;
+
+    // The mock is not thread safe: the properties worker (props.c) does without its connection
+    if (connected)
+        return (xcb_connection_t *)&second_connection;
+
+    connected = true;
+    return (xcb_connection_t *)&connection;
+}
+
+int xcb_connection_has_error(xcb_connection_t *c)
+{
+    return c == (xcb_connection_t *)&second_connection ? XCB_CONN_ERROR : 0;
+}
+
+void xcb_disconnect(__attribute__((unused)) xcb_connection_t *c)
+{
+}
+
+const struct xcb_setup_t *xcb_get_setup(__attribute__((unused)) xcb_connection_t *c)
+{
+    return &setup;
+}
+
+xcb_screen_iterator_t xcb_setup_roots_iterator(__attribute__((unused)) const xcb_setup_t *R)
+{
+    return (xcb_screen_iterator_t){&screen, 1, 0};
+}
+
+void xcb_screen_next(xcb_screen_iterator_t *i)
+{
+    i->rem--;
+    i->data = NULL;
+}
+
+int xcb_flush(__attribute__((unused)) xcb_connection_t *c)
+{
+    mock.flushes++;
+    synced = sequence;
+    return 1;
+}
+
+static xcb_generic_event_t *next_event()
+{
+    if (events_length == 0)
+        return NULL;
+
+    xcb_generic_event_t *event = malloc(sizeof(xcb_generic_event_t));
+    *event = events[events_head];
+    events_head = (events_head + 1) % MOCK_EVENTS_SIZE;
+    events_length--;
+    return event;
+}
+
+// There is no server to wait for: an empty queue ends the event loop like a lost connection
+xcb_generic_event_t *xcb_wait_for_event(__attribute__((unused)) xcb_connection_t *c)
+{
+    return next_event();
+}
+
+xcb_generic_event_t *xcb_poll_for_queued_event(__attribute__((unused)) xcb_connection_t *c)
+{
+    return next_event();
+}
+
+xcb_generic_event_t *xcb_poll_for_event(__attribute__((unused)) xcb_connection_t *c)
+{
+    return next_event();
+}
+
+// There is no socket, poll() ignores negative descriptors
+int xcb_get_file_descriptor(__attribute__((unused)) xcb_connection_t *c)
+{
+    return -1;
+}
+
+/*
+ * Requests without reply
+ */
+
+xcb_void_cookie_t xcb_configure_window(__attribute__((unused)) xcb_connection_t *c,
+                                       xcb_window_t window, uint16_t value_mask,
+                                       const void *value_list)
+{
+    mock_window *w = mock_find_window(window);
+    const uint32_t *values = value_list;
+
+    if (w != NULL)
+    {
+        if (value_mask & XCB_CONFIG_WINDOW_X)
+            w->x = *values++;
+        if (value_mask & XCB_CONFIG_WINDOW_Y)
+            w->y = *values++;
+        if (value_mask & XCB_CONFIG_WINDOW_WIDTH)
+            w->width = *values++;
+        if (value_mask & XCB_CONFIG_WINDOW_HEIGHT)
+            w->height = *values++;
+        if (value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+            w->border_width = *values++;
+    }
+
+    return void_request(XCB_CONFIGURE_WINDOW, window);
+}
+
+xcb_void_cookie_t xcb_change_window_attributes(__attribute__((unused)) xcb_connection_t *c,
+                                               xcb_window_t window,
+                                               __attribute__((unused)) uint32_t value_mask,
+                                               __attribute__((unused)) const void *value_list)
+{
+    return void_request(XCB_CHANGE_WINDOW_ATTRIBUTES, window);
+}
+
+xcb_void_cookie_t xcb_change_window_attributes_checked(xcb_connection_t *c, xcb_window_t window,
+                                                       uint32_t value_mask, const void *value_list)
+{
+    return xcb_change_window_attributes(c, window, value_mask, value_list);
+}
+
+/*
+ * Drawing, nothing is drawn
+ */
+
+uint32_t xcb_generate_id(__attribute__((unused)) xcb_connection_t *c)
+{
+    static uint32_t id = 0x400000;
+    return id++;
+}
+
+xcb_void_cookie_t xcb_create_window(
+    __attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint8_t depth,
+    xcb_window_t wid, __attribute__((unused)) xcb_window_t parent,
+    __attribute__((unused)) int16_t x, __attribute__((unused)) int16_t y,
+    __attribute__((unused)) uint16_t width, __attribute__((unused)) uint16_t height,
+    __attribute__((unused)) uint16_t border_width, __attribute__((unused)) uint16_t _class,
+    __attribute__((unused)) xcb_visualid_t visual, __attribute__((unused)) uint32_t value_mask,
+    __attribute__((unused)) const void *value_list)
+{
+    return void_request(XCB_CREATE_WINDOW, wid);
+}
+
+xcb_void_cookie_t xcb_create_pixmap(__attribute__((unused)) xcb_connection_t *c,
+                                    __attribute__((unused)) uint8_t depth, xcb_pixmap_t pid,
+                                    __attribute__((unused)) xcb_drawable_t drawable,
+                                    __attribute__((unused)) uint16_t width,
+                                    __attribute__((unused)) uint16_t height)
+{
+    return void_request(XCB_CREATE_PIXMAP, pid);
+}
+
+xcb_void_cookie_t xcb_free_pixmap(__attribute__((unused)) xcb_connection_t *c,
+                                  xcb_pixmap_t pixmap)
+{
+    return void_request(XCB_FREE_PIXMAP, pixmap);
+}
+
+xcb_void_cookie_t xcb_create_gc(__attribute__((unused)) xcb_connection_t *c, xcb_gcontext_t cid,
+                                __attribute__((unused)) xcb_drawable_t drawable,
+                                __attribute__((unused)) uint32_t value_mask,
+                                __attribute__((unused)) const void *value_list)
+{
+    return void_request(XCB_CREATE_GC, cid);
+}
+
+xcb_void_cookie_t xcb_change_gc(__attribute__((unused)) xcb_connection_t *c, xcb_gcontext_t gc,
+                                __attribute__((unused)) uint32_t value_mask,
+                                __attribute__((unused)) const void *value_list)
+{
+    return void_request(XCB_CHANGE_GC, gc);
+}
+
+xcb_void_cookie_t xcb_open_font(__attribute__((unused)) xcb_connection_t *c, xcb_font_t fid,
+                                __attribute__((unused)) uint16_t name_len,
+                                __attribute__((unused)) const char *name)
+{
+    return void_request(XCB_OPEN_FONT, fid);
+}
+
+xcb_void_cookie_t xcb_close_font(__attribute__((unused)) xcb_connection_t *c, xcb_font_t font)
+{
+    return void_request(XCB_CLOSE_FONT, font);
+}
+
+xcb_void_cookie_t xcb_poly_fill_rectangle(__attribute__((unused)) xcb_connection_t *c,
+                                          xcb_drawable_t drawable,
+                                          __attribute__((unused)) xcb_gcontext_t gc,
+                                          __attribute__((unused)) uint32_t rectangles_len,
+                                          __attribute__((unused))
+                                          const xcb_rectangle_t *rectangles)
+{
+    return void_request(XCB_POLY_FILL_RECTANGLE, drawable);
+}
+
+xcb_void_cookie_t xcb_image_text_8(__attribute__((unused)) xcb_connection_t *c,
+                                   __attribute__((unused)) uint8_t string_len,
+                                   xcb_drawable_t drawable,
+                                   __attribute__((unused)) xcb_gcontext_t gc,
+                                   __attribute__((unused)) int16_t x,
+                                   __attribute__((unused)) int16_t y,
+                                   __attribute__((unused)) const char *string)
+{
+    return void_request(XCB_IMAGE_TEXT_8, drawable);
+}
+
+xcb_void_cookie_t xcb_copy_area(__attribute__((unused)) xcb_connection_t *c,
+                                __attribute__((unused)) xcb_drawable_t src_drawable,
+                                xcb_drawable_t dst_drawable,
+                                __attribute__((unused)) xcb_gcontext_t gc,
+                                __attribute__((unused)) int16_t src_x,
+                                __attribute__((unused)) int16_t src_y,
+                                __attribute__((unused)) int16_t dst_x,
+                                __attribute__((unused)) int16_t dst_y,
+                                __attribute__((unused)) uint16_t width,
+                                __attribute__((unused)) uint16_t height)
+{
+    return void_request(XCB_COPY_AREA, dst_drawable);
+}
+
+xcb_void_cookie_t xcb_map_window(__attribute__((unused)) xcb_connection_t *c, xcb_window_t window)
+{
+    mock_window *w = mock_find_window(window);
+    if (w != NULL)
+        w->mapped = true;
+
+    return void_request(XCB_MAP_WINDOW, window);
+}
+
+xcb_void_cookie_t xcb_unmap_window(__attribute__((unused)) xcb_connection_t *c, xcb_window_t window)
+{
+    mock_window *w = mock_find_window(window);
+    if (w != NULL)
+        w->mapped = false;
+
+    return void_request(XCB_UNMAP_WINDOW, window);
+}
+
+xcb_void_cookie_t xcb_set_input_focus(__attribute__((unused)) xcb_connection_t *c,
+                                      __attribute__((unused)) uint8_t revert_to, xcb_window_t focus,
+                                      __attribute__((unused)) xcb_timestamp_t time)
+{
+    return void_request(XCB_SET_INPUT_FOCUS, focus);
+}
+
+xcb_grab_pointer_cookie_t xcb_grab_pointer(__attribute__((unused)) xcb_connection_t *c,
+                                   __attribute__((unused)) uint8_t owner_events,
+                                   xcb_window_t grab_window,
+                                   __attribute__((unused)) uint16_t event_mask,
+                                   __attribute__((unused)) uint8_t pointer_mode,
+                                   __attribute__((unused)) uint8_t keyboard_mode,
+                                   __attribute__((unused)) xcb_window_t confine_to,
+                                   __attribute__((unused)) xcb_cursor_t cursor,
+                                   __attribute__((unused)) xcb_timestamp_t time)
+{
+    // The reply is never waited for by kbgwm
+    return (xcb_grab_pointer_cookie_t){request(XCB_GRAB_POINTER, grab_window)};
+}
+
+xcb_void_cookie_t xcb_ungrab_pointer(__attribute__((unused)) xcb_connection_t *c,
+                                     __attribute__((unused)) xcb_timestamp_t time)
+{
+    return void_request(XCB_UNGRAB_POINTER, XCB_NONE);
+}
+
+xcb_grab_keyboard_cookie_t xcb_grab_keyboard(__attribute__((unused)) xcb_connection_t *c,
+                                             __attribute__((unused)) uint8_t owner_events,
+                                             xcb_window_t grab_window,
+                                             __attribute__((unused)) xcb_timestamp_t time,
+                                             __attribute__((unused)) uint8_t pointer_mode,
+                                             __attribute__((unused)) uint8_t keyboard_mode)
+{
+    // The reply is never waited for by kbgwm
+    return (xcb_grab_keyboard_cookie_t){request(XCB_GRAB_KEYBOARD, grab_window)};
+}
+
+xcb_void_cookie_t xcb_ungrab_keyboard(__attribute__((unused)) xcb_connection_t *c,
+                                      __attribute__((unused)) xcb_timestamp_t time)
+{
+    return void_request(XCB_UNGRAB_KEYBOARD, XCB_NONE);
+}
+
+xcb_void_cookie_t xcb_grab_button(__attribute__((unused)) xcb_connection_t *c,
+                                  __attribute__((unused)) uint8_t owner_events,
+                                  xcb_window_t grab_window,
+                                  __attribute__((unused)) uint16_t event_mask,
+                                  __attribute__((unused)) uint8_t pointer_mode,
+                                  __attribute__((unused)) uint8_t keyboard_mode,
+                                  __attribute__((unused)) xcb_window_t confine_to,
+                                  __attribute__((unused)) xcb_cursor_t cursor,
+                                  __attribute__((unused)) uint8_t button,
+                                  __attribute__((unused)) uint16_t modifiers)
+{
+    return void_request(XCB_GRAB_BUTTON, grab_window);
+}
+
+xcb_void_cookie_t xcb_ungrab_button(__attribute__((unused)) xcb_connection_t *c,
+                                    __attribute__((unused)) uint8_t button,
+                                    xcb_window_t grab_window,
+                                    __attribute__((unused)) uint16_t modifiers)
+{
+    return void_request(XCB_UNGRAB_BUTTON, grab_window);
+}
+
+xcb_void_cookie_t xcb_grab_key(__attribute__((unused)) xcb_connection_t *c,
+                               __attribute__((unused)) uint8_t owner_events,
+                               xcb_window_t grab_window, __attribute__((unused)) uint16_t modifiers,
+                               __attribute__((unused)) xcb_keycode_t key,
+                               __attribute__((unused)) uint8_t pointer_mode,
+                               __attribute__((unused)) uint8_t keyboard_mode)
+{
+    return void_request(XCB_GRAB_KEY, grab_window);
+}
+
+xcb_void_cookie_t xcb_ungrab_key(__attribute__((unused)) xcb_connection_t *c,
+                                 __attribute__((unused)) xcb_keycode_t key,
+                                 xcb_window_t grab_window,
+                                 __attribute__((unused)) uint16_t modifiers)
+{
+    return void_request(XCB_UNGRAB_KEY, grab_window);
+}
+
+xcb_void_cookie_t xcb_change_property(__attribute__((unused)) xcb_connection_t *c,
+                                      __attribute__((unused)) uint8_t mode, xcb_window_t window,
+                                      __attribute__((unused)) xcb_atom_t property,
+                                      __attribute__((unused)) xcb_atom_t type,
+                                      __attribute__((unused)) uint8_t format,
+                                      __attribute__((unused)) uint32_t data_len,
+                                      __attribute__((unused)) const void *data)
+{
+    return void_request(XCB_CHANGE_PROPERTY, window);
+}
+
+xcb_void_cookie_t xcb_delete_property(__attribute__((unused)) xcb_connection_t *c,
+                                      xcb_window_t window,
+                                      __attribute__((unused)) xcb_atom_t property)
+{
+    return void_request(XCB_DELETE_PROPERTY, window);
+}
+
+xcb_void_cookie_t xcb_kill_client(__attribute__((unused)) xcb_connection_t *c, uint32_t resource)
+{
+    return void_request(XCB_KILL_CLIENT, resource);
+}
+
+xcb_void_cookie_t xcb_send_event(__attribute__((unused)) xcb_connection_t *c,
+                                 __attribute__((unused)) uint8_t propagate,
+                                 xcb_window_t destination,
+                                 __attribute__((unused)) uint32_t event_mask,
+                                 __attribute__((unused)) const char *event)
+{
+    mock.sent_events++;
+    return void_request(XCB_SEND_EVENT, destination);
+}
+
+/*
+ * Requests with reply
+ */
+
+xcb_get_geometry_cookie_t xcb_get_geometry_unchecked(__attribute__((unused)) xcb_connection_t *c,
+                                                     xcb_drawable_t drawable)
+{
+    return (xcb_get_geometry_cookie_t){request(XCB_GET_GEOMETRY, drawable)};
+}
+
+xcb_get_geometry_reply_t *xcb_get_geometry_reply(__attribute__((unused)) xcb_connection_t *c,
+                                                 xcb_get_geometry_cookie_t cookie,
+                                                 __attribute__((unused)) xcb_generic_error_t **e)
+{
+    mock_window *w = mock_find_window(wait_reply(cookie.sequence).resource);
+    if (w == NULL)
+        return NULL;
+
+    xcb_get_geometry_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->root = MOCK_ROOT;
+    reply->x = w->x;
+    reply->y = w->y;
+    reply->width = w->width;
+    reply->height = w->height;
+    reply->border_width = w->border_width;
+    return reply;
+}
+
+xcb_get_window_attributes_cookie_t xcb_get_window_attributes_unchecked(
+    __attribute__((unused)) xcb_connection_t *c, xcb_window_t window)
+{
+    return (xcb_get_window_attributes_cookie_t){request(XCB_GET_WINDOW_ATTRIBUTES, window)};
+}
+
+xcb_get_window_attributes_reply_t *xcb_get_window_attributes_reply(
+    __attribute__((unused)) xcb_connection_t *c, xcb_get_window_attributes_cookie_t cookie,
+    __attribute__((unused)) xcb_generic_error_t **e)
+{
+    mock_window *w = mock_find_window(wait_reply(cookie.sequence).resource);
+    if (w == NULL)
+        return NULL;
+
+    xcb_get_window_attributes_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->visual = MOCK_VISUAL;
+    reply->map_state = w->mapped ? XCB_MAP_STATE_VIEWABLE : XCB_MAP_STATE_UNMAPPED;
+    return reply;
+}
+
+xcb_query_tree_cookie_t xcb_query_tree(__attribute__((unused)) xcb_connection_t *c,
+                                       xcb_window_t window)
+{
+    return (xcb_query_tree_cookie_t){request(XCB_QUERY_TREE, window)};
+}
+
+xcb_query_tree_reply_t *xcb_query_tree_reply(__attribute__((unused)) xcb_connection_t *c,
+                                             xcb_query_tree_cookie_t cookie,
+                                             __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    // Only the windows mapped are reported, as if the others were not created yet
+    xcb_query_tree_reply_t *reply =
+        calloc(1, sizeof(*reply) + windows_length * sizeof(xcb_window_t));
+    xcb_window_t *children = (xcb_window_t *)(reply + 1);
+
+    reply->root = MOCK_ROOT;
+    for (uint_fast32_t i = 0; i != windows_length; i++)
+        if (windows[i].mapped)
+            children[reply->children_len++] = windows[i].id;
+
+    return reply;
+}
+
+int xcb_query_tree_children_length(const xcb_query_tree_reply_t *R)
+{
+    return R->children_len;
+}
+
+xcb_window_t *xcb_query_tree_children(const xcb_query_tree_reply_t *R)
+{
+    return (xcb_window_t *)(R + 1);
+}
+
+xcb_get_modifier_mapping_cookie_t xcb_get_modifier_mapping_unchecked(
+    __attribute__((unused)) xcb_connection_t *c)
+{
+    return (xcb_get_modifier_mapping_cookie_t){request(XCB_GET_MODIFIER_MAPPING, XCB_NONE)};
+}
+
+// One keycode per modifier, Num_Lock is MOD2
+xcb_get_modifier_mapping_reply_t *xcb_get_modifier_mapping_reply(
+    __attribute__((unused)) xcb_connection_t *c, xcb_get_modifier_mapping_cookie_t cookie,
+    __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    xcb_get_modifier_mapping_reply_t *reply = calloc(1, sizeof(*reply) + 8);
+    reply->keycodes_per_modifier = 1;
+
+    xcb_keycode_t *numlock = xcb_key_symbols_get_keycode(NULL, 0xff7f /* XK_Num_Lock */);
+    xcb_get_modifier_mapping_keycodes(reply)[4] = *numlock;
+    free(numlock);
+
+    return reply;
+}
+
+xcb_keycode_t *xcb_get_modifier_mapping_keycodes(const xcb_get_modifier_mapping_reply_t *R)
+{
+    return (xcb_keycode_t *)(R + 1);
+}
+
+xcb_intern_atom_cookie_t xcb_intern_atom(__attribute__((unused)) xcb_connection_t *c,
+                                         __attribute__((unused)) uint8_t only_if_exists,
+                                         uint16_t name_len, const char *name)
+{
+    unsigned int cookie = request(XCB_INTERN_ATOM, XCB_NONE);
+    in_flight[cookie % MOCK_IN_FLIGHT_SIZE].resource = atom(name, name_len);
+    return (xcb_intern_atom_cookie_t){cookie};
+}
+
+xcb_intern_atom_reply_t *xcb_intern_atom_reply(__attribute__((unused)) xcb_connection_t *c,
+                                               xcb_intern_atom_cookie_t cookie,
+                                               __attribute__((unused)) xcb_generic_error_t **e)
+{
+    xcb_intern_atom_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->atom = wait_reply(cookie.sequence).resource;
+    return reply;
+}
+
+xcb_get_property_cookie_t xcb_get_property_unchecked(__attribute__((unused)) xcb_connection_t *c,
+                                                     __attribute__((unused)) uint8_t _delete,
+                                                     xcb_window_t window, xcb_atom_t property,
+                                                     __attribute__((unused)) xcb_atom_t type,
+                                                     __attribute__((unused)) uint32_t long_offset,
+                                                     __attribute__((unused)) uint32_t long_length)
+{
+    unsigned int cookie = request(XCB_GET_PROPERTY, window);
+    in_flight[cookie % MOCK_IN_FLIGHT_SIZE].detail = property;
+    return (xcb_get_property_cookie_t){cookie};
+}
+
+xcb_get_property_cookie_t xcb_get_property(xcb_connection_t *c, uint8_t _delete,
+                                           xcb_window_t window, xcb_atom_t property,
+                                           xcb_atom_t type, uint32_t long_offset,
+                                           uint32_t long_length)
+{
+    return xcb_get_property_unchecked(c, _delete, window, property, type, long_offset,
+                                      long_length);
+}
+
+// A missing property is answered with an empty reply, like the X server does
+// Replies polled for are there as soon as asked, the round trip is still counted
+int xcb_poll_for_reply(xcb_connection_t *c, unsigned int request, void **reply,
+                       xcb_generic_error_t **error)
+{
+    *reply = xcb_get_property_reply(c, (xcb_get_property_cookie_t){request}, error);
+    return 1;
+}
+
+void xcb_discard_reply(__attribute__((unused)) xcb_connection_t *c,
+                       __attribute__((unused)) unsigned int sequence)
+{
+}
+
+xcb_query_font_cookie_t xcb_query_font(__attribute__((unused)) xcb_connection_t *c,
+                                       xcb_fontable_t font)
+{
+    return (xcb_query_font_cookie_t){request(XCB_QUERY_FONT, font)};
+}
+
+// The metrics of the "fixed" font
+xcb_query_font_reply_t *xcb_query_font_reply(__attribute__((unused)) xcb_connection_t *c,
+                                             xcb_query_font_cookie_t cookie,
+                                             __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    xcb_query_font_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->max_bounds.character_width = 6;
+    reply->font_ascent = 11;
+    reply->font_descent = 2;
+    return reply;
+}
+
+xcb_get_property_reply_t *xcb_get_property_reply(__attribute__((unused)) xcb_connection_t *c,
+                                                 xcb_get_property_cookie_t cookie,
+                                                 __attribute__((unused)) xcb_generic_error_t **e)
+{
+    request_target target = wait_reply(cookie.sequence);
+    mock_property *property = find_property(mock_find_window(target.resource), target.detail);
+    uint32_t size = property == NULL ? 0 : property->length * property->format / 8;
+
+    xcb_get_property_reply_t *reply = calloc(1, sizeof(*reply) + size + 1);
+    if (property != NULL)
+    {
+        reply->format = property->format;
+        reply->type = property->type;
+        reply->value_len = property->length;
+        reply->length = (size + 3) / 4;
+        memcpy(reply + 1, property->value, size);
+    }
+
+    return reply;
+}
+
+void *xcb_get_property_value(const xcb_get_property_reply_t *R)
+{
+    return (void *)(R + 1);
+}
+
+int xcb_get_property_value_length(const xcb_get_property_reply_t *R)
+{
+    return R->value_len * (R->format / 8);
+}
+
+/*
+ * libxcb-icccm
+ */
+
+// The property is remembered for the refetches, which only poll for the reply
+xcb_get_property_cookie_t xcb_icccm_get_wm_normal_hints_unchecked(xcb_connection_t *c,
+                                                                  xcb_window_t window)
+{
+    return xcb_get_property_unchecked(c, 0, window, XCB_ATOM_WM_NORMAL_HINTS,
+                                      XCB_ATOM_WM_SIZE_HINTS, 0, 18);
+}
+
+uint8_t xcb_icccm_get_wm_normal_hints_reply(__attribute__((unused)) xcb_connection_t *c,
+                                            xcb_get_property_cookie_t cookie,
+                                            xcb_size_hints_t *hints,
+                                            __attribute__((unused)) xcb_generic_error_t **e)
+{
+    mock_window *w = mock_find_window(wait_reply(cookie.sequence).resource);
+    if (w == NULL)
+        return 0;
+
+    memset(hints, 0, sizeof(*hints));
+    hints->flags = XCB_ICCCM_SIZE_HINT_P_MIN_SIZE | XCB_ICCCM_SIZE_HINT_P_MAX_SIZE;
+    hints->min_width = w->min_width;
+    hints->min_height = w->min_height;
+    hints->max_width = w->max_width;
+    hints->max_height = w->max_height;
+    return 1;
+}
+
+xcb_get_property_cookie_t xcb_icccm_get_wm_protocols_unchecked(xcb_connection_t *c,
+                                                               xcb_window_t window,
+                                                               xcb_atom_t wm_protocol_atom)
+{
+    return xcb_get_property_unchecked(c, 0, window, wm_protocol_atom, XCB_ATOM_ATOM, 0, UINT32_MAX);
+}
+
+uint8_t xcb_icccm_get_wm_protocols_reply(__attribute__((unused)) xcb_connection_t *c,
+                                         xcb_get_property_cookie_t cookie,
+                                         xcb_icccm_get_wm_protocols_reply_t *protocols,
+                                         __attribute__((unused)) xcb_generic_error_t **e)
+{
+    static xcb_atom_t wm_delete_window;
+
+    mock_window *w = mock_find_window(wait_reply(cookie.sequence).resource);
+    if (w == NULL || !w->delete_window)
+        return 0;
+
+    // Looked up by the server itself, it is not a request of the client
+    wm_delete_window = atom("WM_DELETE_WINDOW", 16);
+
+    protocols->atoms_len = 1;
+    protocols->atoms = &wm_delete_window;
+    protocols->_reply = NULL;
+    return 1;
+}
+
+xcb_get_property_cookie_t xcb_icccm_get_wm_class_unchecked(xcb_connection_t *c,
+                                                           xcb_window_t window)
+{
+    return xcb_get_property_unchecked(c, 0, window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 2048);
+}
+
+// WM_CLASS is "instance\0class\0"
+uint8_t xcb_icccm_get_wm_class_reply(xcb_connection_t *c, xcb_get_property_cookie_t cookie,
+                                     xcb_icccm_get_wm_class_reply_t *prop,
+                                     xcb_generic_error_t **e)
+{
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(c, cookie, e);
+
+    if (reply->value_len == 0)
+    {
+        free(reply);
+        return 0;
+    }
+
+    prop->_reply = reply;
+    prop->instance_name = xcb_get_property_value(reply);
+    prop->class_name = prop->instance_name + strlen(prop->instance_name) + 1;
+    return 1;
+}
+
+void xcb_icccm_get_wm_class_reply_wipe(xcb_icccm_get_wm_class_reply_t *prop)
+{
+    free(prop->_reply);
+}
+
+uint8_t xcb_icccm_get_wm_protocols_from_reply(xcb_get_property_reply_t *reply,
+                                              xcb_icccm_get_wm_protocols_reply_t *protocols)
+{
+    if (reply->type != XCB_ATOM_ATOM || reply->format != 32)
+        return 0;
+
+    protocols->atoms_len = xcb_get_property_value_length(reply) / 4;
+    protocols->atoms = xcb_get_property_value(reply);
+    protocols->_reply = reply;
+    return 1;
+}
+
+uint8_t xcb_icccm_get_wm_size_hints_from_reply(xcb_size_hints_t *hints,
+                                               xcb_get_property_reply_t *reply)
+{
+    // The first 15 fields are mandatory, base size and gravity came later
+    int length = xcb_get_property_value_length(reply);
+    if (reply->format != 32 || length < 15 * 4)
+        return 0;
+
+    memset(hints, 0, sizeof(*hints));
+    memcpy(hints, xcb_get_property_value(reply),
+           (size_t)length < sizeof(*hints) ? (size_t)length : sizeof(*hints));
+    return 1;
+}
+
+void xcb_icccm_get_wm_protocols_reply_wipe(xcb_icccm_get_wm_protocols_reply_t *protocols)
+{
+    free(protocols->_reply);
+    protocols->atoms_len = 0;
+}
+
+/*
+ * libxcb-keysyms
+ */
+
+xcb_key_symbols_t *xcb_key_symbols_alloc(__attribute__((unused)) xcb_connection_t *c)
+{
+    // The keyboard mapping is requested here and waited for on the first lookup
+    request(XCB_GET_KEYBOARD_MAPPING, XCB_NONE);
+    return (xcb_key_symbols_t *)&connection;
+}
+
+void xcb_key_symbols_free(__attribute__((unused)) xcb_key_symbols_t *syms)
+{
+}
+
+// Keycodes are handed out in the order keysyms are first looked up
+xcb_keycode_t *xcb_key_symbols_get_keycode(xcb_key_symbols_t *syms, xcb_keysym_t keysym)
+{
+    if (syms != NULL)
+        wait_reply(sequence);
+
+    xcb_keycode_t *keycode = calloc(2, sizeof(xcb_keycode_t));
+
+    for (uint_fast32_t i = 8; i != keycodes_length; i++)
+    {
+        if (keycodes[i] == keysym)
+        {
+            keycode[0] = i;
+            return keycode;
+        }
+    }
+
+    if (keycodes_length != 256)
+    {
+        keycodes[keycodes_length] = keysym;
+        keycode[0] = keycodes_length++;
+    }
+
+    return keycode;
+}
+
+xcb_keysym_t xcb_key_symbols_get_keysym(__attribute__((unused)) xcb_key_symbols_t *syms,
+                                        xcb_keycode_t keycode, __attribute__((unused)) int col)
+{
+    wait_reply(sequence);
+    return keycode < keycodes_length ? keycodes[keycode] : 0;
+}
+
+// Same ranges as libxcb-keysyms
+int xcb_is_modifier_key(xcb_keysym_t keysym)
+{
+    return (keysym >= 0xffe1 && keysym <= 0xffee) ||   // XK_Shift_L to XK_Hyper_R
+           (keysym >= 0xfe01 && keysym <= 0xfe13) ||   // XK_ISO_Lock to XK_ISO_Level5_Lock
+           keysym == 0xff7e || keysym == 0xff7f;       // XK_Mode_switch, XK_Num_Lock
+}
+
+/*
+ * libxcb-xinput
+ */
+
+xcb_extension_t xcb_input_id = {"XInputExtension", 0};
+
+static xcb_query_extension_reply_t xinput = {.present = 1, .major_opcode = MOCK_XINPUT_OPCODE};
+static xcb_query_extension_reply_t damage = {
+    .present = 1, .major_opcode = MOCK_DAMAGE_OPCODE, .first_event = MOCK_DAMAGE_FIRST_EVENT};
+static xcb_query_extension_reply_t present = {.present = 1, .major_opcode = MOCK_PRESENT_OPCODE};
+static xcb_query_extension_reply_t composite = {.present = 1,
+                                                .major_opcode = MOCK_COMPOSITE_OPCODE};
+static xcb_query_extension_reply_t render = {.present = 1, .major_opcode = MOCK_RENDER_OPCODE};
+
+const xcb_query_extension_reply_t *xcb_get_extension_data(__attribute__((unused))
+                                                          xcb_connection_t *c,
+                                                          xcb_extension_t *ext)
+{
+    return ext == &xcb_input_id       ? &xinput
+           : ext == &xcb_damage_id    ? &damage
+           : ext == &xcb_present_id   ? &present
+           : ext == &xcb_composite_id ? &composite
+           : ext == &xcb_render_id    ? &render
+                                      : NULL;
+}
+
+xcb_input_xi_query_version_cookie_t xcb_input_xi_query_version(
+    __attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint16_t major_version,
+    __attribute__((unused)) uint16_t minor_version)
+{
+    return (xcb_input_xi_query_version_cookie_t){request(MOCK_XINPUT_OPCODE, XCB_NONE)};
+}
+
+xcb_input_xi_query_version_reply_t *xcb_input_xi_query_version_reply(
+    __attribute__((unused)) xcb_connection_t *c, xcb_input_xi_query_version_cookie_t cookie,
+    __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    xcb_input_xi_query_version_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->major_version = 2;
+    reply->minor_version = 2;
+    return reply;
+}
+
+xcb_void_cookie_t xcb_input_xi_select_events(__attribute__((unused)) xcb_connection_t *c,
+                                             xcb_window_t window,
+                                             __attribute__((unused)) uint16_t num_mask,
+                                             __attribute__((unused))
+                                             const xcb_input_event_mask_t *masks)
+{
+    return void_request(MOCK_XINPUT_OPCODE, window);
+}
+
+/*
+ * libxcb-composite, libxcb-damage, libxcb-render and libxcb-render-util
+ */
+
+xcb_extension_t xcb_composite_id = {"Composite", 0};
+xcb_extension_t xcb_damage_id = {"DAMAGE", 0};
+xcb_extension_t xcb_render_id = {"RENDER", 0};
+
+xcb_composite_query_version_cookie_t xcb_composite_query_version(
+    __attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint32_t major_version,
+    __attribute__((unused)) uint32_t minor_version)
+{
+    return (xcb_composite_query_version_cookie_t){request(MOCK_COMPOSITE_OPCODE, XCB_NONE)};
+}
+
+xcb_composite_query_version_reply_t *xcb_composite_query_version_reply(
+    __attribute__((unused)) xcb_connection_t *c, xcb_composite_query_version_cookie_t cookie,
+    __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    xcb_composite_query_version_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->major_version = 0;
+    reply->minor_version = 4;
+    return reply;
+}
+
+xcb_void_cookie_t xcb_composite_redirect_subwindows(__attribute__((unused)) xcb_connection_t *c,
+                                                    xcb_window_t window,
+                                                    __attribute__((unused)) uint8_t update)
+{
+    return void_request(MOCK_COMPOSITE_OPCODE, window);
+}
+
+xcb_void_cookie_t xcb_composite_unredirect_subwindows(__attribute__((unused)) xcb_connection_t *c,
+                                                      xcb_window_t window,
+                                                      __attribute__((unused)) uint8_t update)
+{
+    return void_request(MOCK_COMPOSITE_OPCODE, window);
+}
+
+xcb_damage_query_version_cookie_t xcb_damage_query_version(
+    __attribute__((unused)) xcb_connection_t *c,
+    __attribute__((unused)) uint32_t client_major_version,
+    __attribute__((unused)) uint32_t client_minor_version)
+{
+    return (xcb_damage_query_version_cookie_t){request(MOCK_DAMAGE_OPCODE, XCB_NONE)};
+}
+
+xcb_damage_query_version_reply_t *xcb_damage_query_version_reply(
+    __attribute__((unused)) xcb_connection_t *c, xcb_damage_query_version_cookie_t cookie,
+    __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    xcb_damage_query_version_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->major_version = 1;
+    reply->minor_version = 1;
+    return reply;
+}
+
+xcb_void_cookie_t xcb_damage_create(__attribute__((unused)) xcb_connection_t *c,
+                                    __attribute__((unused)) xcb_damage_damage_t damage,
+                                    xcb_drawable_t drawable,
+                                    __attribute__((unused)) uint8_t level)
+{
+    return void_request(MOCK_DAMAGE_OPCODE, drawable);
+}
+
+xcb_void_cookie_t xcb_damage_subtract(__attribute__((unused)) xcb_connection_t *c,
+                                      xcb_damage_damage_t damage,
+                                      __attribute__((unused)) xcb_xfixes_region_t repair,
+                                      __attribute__((unused)) xcb_xfixes_region_t parts)
+{
+    return void_request(MOCK_DAMAGE_OPCODE, damage);
+}
+
+xcb_void_cookie_t xcb_render_create_picture(__attribute__((unused)) xcb_connection_t *c,
+                                            __attribute__((unused)) xcb_render_picture_t pid,
+                                            xcb_drawable_t drawable,
+                                            __attribute__((unused)) xcb_render_pictformat_t format,
+                                            __attribute__((unused)) uint32_t value_mask,
+                                            __attribute__((unused)) const void *value_list)
+{
+    return void_request(MOCK_RENDER_OPCODE, drawable);
+}
+
+xcb_void_cookie_t xcb_render_free_picture(__attribute__((unused)) xcb_connection_t *c,
+                                          xcb_render_picture_t picture)
+{
+    return void_request(MOCK_RENDER_OPCODE, picture);
+}
+
+xcb_void_cookie_t xcb_render_set_picture_transform(__attribute__((unused)) xcb_connection_t *c,
+                                                   xcb_render_picture_t picture,
+                                                   __attribute__((unused))
+                                                   xcb_render_transform_t transform)
+{
+    return void_request(MOCK_RENDER_OPCODE, picture);
+}
+
+xcb_void_cookie_t xcb_render_set_picture_filter(__attribute__((unused)) xcb_connection_t *c,
+                                                xcb_render_picture_t picture,
+                                                __attribute__((unused)) uint16_t filter_len,
+                                                __attribute__((unused)) const char *filter,
+                                                __attribute__((unused)) uint32_t values_len,
+                                                __attribute__((unused))
+                                                const xcb_render_fixed_t *values)
+{
+    return void_request(MOCK_RENDER_OPCODE, picture);
+}
+
+xcb_void_cookie_t xcb_render_composite(
+    __attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint8_t op,
+    __attribute__((unused)) xcb_render_picture_t src,
+    __attribute__((unused)) xcb_render_picture_t mask, xcb_render_picture_t dst,
+    __attribute__((unused)) int16_t src_x, __attribute__((unused)) int16_t src_y,
+    __attribute__((unused)) int16_t mask_x, __attribute__((unused)) int16_t mask_y,
+    __attribute__((unused)) int16_t dst_x, __attribute__((unused)) int16_t dst_y,
+    __attribute__((unused)) uint16_t width, __attribute__((unused)) uint16_t height)
+{
+    return void_request(MOCK_RENDER_OPCODE, dst);
+}
+
+xcb_void_cookie_t xcb_render_fill_rectangles(__attribute__((unused)) xcb_connection_t *c,
+                                             __attribute__((unused)) uint8_t op,
+                                             xcb_render_picture_t dst,
+                                             __attribute__((unused)) xcb_render_color_t color,
+                                             __attribute__((unused)) uint32_t rects_len,
+                                             __attribute__((unused))
+                                             const xcb_rectangle_t *rects)
+{
+    return void_request(MOCK_RENDER_OPCODE, dst);
+}
+
+// A single visual, every window uses it
+static xcb_render_query_pict_formats_reply_t formats;
+static xcb_render_pictvisual_t pictvisual = {.visual = MOCK_VISUAL, .format = 1};
+
+const xcb_render_query_pict_formats_reply_t *xcb_render_util_query_formats(
+    __attribute__((unused)) xcb_connection_t *c)
+{
+    // Fetched once, libxcb-render-util caches them
+    static bool queried = false;
+    if (!queried)
+    {
+        queried = true;
+        wait_reply(request(MOCK_RENDER_OPCODE, XCB_NONE));
+    }
+
+    return &formats;
+}
+
+xcb_render_pictvisual_t *xcb_render_util_find_visual_format(
+    __attribute__((unused)) const xcb_render_query_pict_formats_reply_t *formats,
+    xcb_visualid_t visual)
+{
+    return visual == MOCK_VISUAL ? &pictvisual : NULL;
+}
+
+/*
+ * libxcb-present
+ */
+
+xcb_extension_t xcb_present_id = {"Present", 0};
+
+xcb_present_query_version_cookie_t xcb_present_query_version(
+    __attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint32_t major_version,
+    __attribute__((unused)) uint32_t minor_version)
+{
+    return (xcb_present_query_version_cookie_t){request(MOCK_PRESENT_OPCODE, XCB_NONE)};
+}
+
+xcb_present_query_version_reply_t *xcb_present_query_version_reply(
+    __attribute__((unused)) xcb_connection_t *c, xcb_present_query_version_cookie_t cookie,
+    __attribute__((unused)) xcb_generic_error_t **e)
+{
+    wait_reply(cookie.sequence);
+
+    xcb_present_query_version_reply_t *reply = calloc(1, sizeof(*reply));
+    reply->major_version = 1;
+    reply->minor_version = 2;
+    return reply;
+}
+
+xcb_void_cookie_t xcb_present_select_input(__attribute__((unused)) xcb_connection_t *c,
+                                           __attribute__((unused)) xcb_present_event_t eid,
+                                           xcb_window_t window,
+                                           __attribute__((unused)) uint32_t event_mask)
+{
+    return void_request(MOCK_PRESENT_OPCODE, window);
+}
+
+// The next vblank comes right away, its CompleteNotify is queued with the request
+xcb_void_cookie_t xcb_present_notify_msc(__attribute__((unused)) xcb_connection_t *c,
+                                         xcb_window_t window, uint32_t serial,
+                                         __attribute__((unused)) uint64_t target_msc,
+                                         __attribute__((unused)) uint64_t divisor,
+                                         __attribute__((unused)) uint64_t remainder)
+{
+    static uint64_t msc = 0;
+
+    xcb_present_complete_notify_event_t event = {.response_type = XCB_GE_GENERIC,
+                                                 .extension = MOCK_PRESENT_OPCODE,
+                                                 .event_type = XCB_PRESENT_COMPLETE_NOTIFY,
+                                                 .kind = XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC,
+                                                 .window = window,
+                                                 .serial = serial,
+                                                 .msc = ++msc};
+    mock_queue_event(&event);
+
+    return void_request(MOCK_PRESENT_OPCODE, window);
+}
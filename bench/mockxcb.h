@@ -0,0 +1,84 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * In-memory stand-in for libxcb, libxcb-icccm and libxcb-keysyms.
+ *
+ * The kbgwm sources are linked against it instead of the real libraries: every request is
+ * recorded, replies are answered from a model of the windows, and flushes and round trips are
+ * counted. A round trip is counted whenever a reply is waited for while requests are still in
+ * flight, so pipelined requests only cost one.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+typedef struct
+{
+    uint8_t opcode;
+    xcb_window_t window;
+} mock_request;
+
+typedef struct
+{
+    uint_fast64_t requests;
+    uint_fast64_t flushes;
+    uint_fast64_t round_trips;
+    uint_fast64_t sent_events;
+    uint_fast64_t by_opcode[256];
+} mock_stats;
+
+#define MOCK_PROPERTIES_SIZE 8
+
+typedef struct
+{
+    xcb_atom_t atom;
+    xcb_atom_t type;
+    uint8_t format;
+    uint32_t length; // In format units
+    void *value;
+} mock_property;
+
+typedef struct
+{
+    xcb_window_t id;
+    int16_t x, y;
+    uint16_t width, height;
+    uint16_t border_width;
+    bool mapped;
+    bool delete_window; // WM_DELETE_WINDOW in WM_PROTOCOLS
+    int32_t min_width, min_height;
+    int32_t max_width, max_height;
+    mock_property properties[MOCK_PROPERTIES_SIZE];
+} mock_window;
+
+extern mock_stats mock;
+extern mock_request *mock_requests; // Every request issued since the last reset
+extern size_t mock_requests_length;
+
+void mock_reset();
+void mock_reset_stats();
+xcb_window_t mock_create_window(int16_t, int16_t, uint16_t, uint16_t);
+mock_window *mock_find_window(xcb_window_t);
+void mock_adopt_window(xcb_window_t, int16_t, int16_t, uint16_t, uint16_t);
+void mock_queue_event(const void *);
+xcb_atom_t mock_atom(const char *);
+void mock_set_property(xcb_window_t, xcb_atom_t, xcb_atom_t, uint8_t, uint32_t, const void *);
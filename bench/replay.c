@@ -0,0 +1,85 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Replay of an event log (kbgwm -r) against the mock X server, so the time spent handling the
+ * events does not depend on the X server or on the windows it has. The windows of the log are
+ * recreated on the mock first, with the ID they were recorded with: the geometry of their
+ * CreateNotify, or a default one for the windows that only show up in a MapRequest (those that
+ * existed when the recording started).
+ */
+
+#include "../record.h"
+#include "mockxcb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_DEFAULT_WIDTH 640
+#define REPLAY_DEFAULT_HEIGHT 480
+
+// kbgwm.c, built with -Dmain=kbgwm_main
+int kbgwm_main(int argc, char **argv);
+
+static bool adopt_windows(const char *path)
+{
+    xcb_generic_event_t *event;
+    replay_result result;
+
+    if (!replay_open(path))
+        return false;
+
+    while ((result = replay_next(&event, false)) != REPLAY_EOF)
+    {
+        if (result != REPLAY_EVENT)
+            continue;
+
+        uint8_t type = event->response_type & ~0x80;
+        if (type == XCB_CREATE_NOTIFY)
+        {
+            xcb_create_notify_event_t *create = (xcb_create_notify_event_t *)event;
+            mock_adopt_window(create->window, create->x, create->y, create->width,
+                              create->height);
+        }
+        else if (type == XCB_MAP_REQUEST)
+            mock_adopt_window(((xcb_map_request_event_t *)event)->window, 0, 0,
+                              REPLAY_DEFAULT_WIDTH, REPLAY_DEFAULT_HEIGHT);
+
+        free(event);
+    }
+
+    replay_close();
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3 || (strcmp(argv[1], "-p") != 0 && strcmp(argv[1], "-P") != 0))
+    {
+        fprintf(stderr, "usage: %s -p|-P log\n", argv[0]);
+        return 1;
+    }
+
+    if (!adopt_windows(argv[2]))
+        return 1;
+
+    return kbgwm_main(argc, argv);
+}
@@ -0,0 +1,284 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "chord.h"
+#include "audit.h"
+#include "kbgwm.h"
+#include "xcbutils.h"
+#include "xerror.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <xcb/xcb_keysyms.h>
+
+#define CLEANMASK(mask) (mask & ~(numlockmask | XCB_MOD_MASK_LOCK))
+
+typedef struct
+{
+    xcb_keycode_t keycode;
+    uint16_t modifiers;         // Without the lock modifiers
+    uint16_t child;             // First node following this one, 0 for none (0 is the root)
+    uint16_t sibling;           // Next node following the same parent, 0 for none
+    void (*func)(const Arg *);  // Bound at the end of a binding, NULL for a prefix
+    const Arg *arg;
+} chord_node;
+
+static chord_node *nodes = NULL;
+static uint_fast16_t nodes_length = 0;
+static uint_fast16_t nodes_size = 0;
+
+static xcb_key_symbols_t *keysyms = NULL; // Keyboard mapping of the current trie
+
+static uint16_t state = 0;    // Node of the chord in progress, 0 when there is none
+static uint64_t deadline = 0; // The chord in progress is dropped then, 0 for never
+
+static uint64_t chord_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// The node of a trie following another one for a key press, 0 if there is none
+static uint16_t chord_find(const chord_node *trie, uint16_t node, xcb_keycode_t keycode,
+                           uint16_t modifiers)
+{
+    for (uint16_t child = trie[node].child; child != 0; child = trie[child].sibling)
+        if (trie[child].keycode == keycode && trie[child].modifiers == modifiers)
+            return child;
+
+    return 0;
+}
+
+static uint16_t chord_add(uint16_t parent, xcb_keycode_t keycode, uint16_t modifiers)
+{
+    uint16_t child = chord_find(nodes, parent, keycode, modifiers);
+    if (child != 0)
+        return child;
+
+    if (nodes_length == nodes_size)
+    {
+        nodes_size *= 2;
+        nodes = realloc(nodes, nodes_size * sizeof(chord_node));
+        if (nodes == NULL || nodes_size > UINT16_MAX)
+        {
+            perror("chord_add");
+            exit(1);
+        }
+    }
+
+    child = nodes_length++;
+    nodes[child] = (chord_node){.keycode = keycode,
+                                .modifiers = modifiers,
+                                .child = 0,
+                                .sibling = nodes[parent].child,
+                                .func = NULL,
+                                .arg = NULL};
+    nodes[parent].child = child;
+    return child;
+}
+
+// Add the strokes of a binding below a node, each keycode of a keysym is a branch
+static void chord_insert(xcb_key_symbols_t *keysyms, uint16_t parent, const Stroke *strokes,
+                         uint_fast8_t length, void (*func)(const Arg *), const Arg *arg)
+{
+    uint16_t modifiers = CLEANMASK(strokes[0].modifiers);
+    xcb_keycode_t *keycodes = AUDIT_REPLY(xcb_key_symbols_get_keycode(keysyms, strokes[0].keysym));
+    if (keycodes == NULL)
+        return; // Nothing to be done
+
+    for (uint_fast8_t i = 0; keycodes[i] != XCB_NO_SYMBOL; i++)
+    {
+        uint16_t node = chord_add(parent, keycodes[i], modifiers);
+
+        if (length > 1 && nodes[node].func != NULL)
+            printf("chord_insert: key %d / %d is bound already, chord ignored\n", modifiers,
+                   strokes[0].keysym);
+        else if (length > 1)
+            chord_insert(keysyms, node, strokes + 1, length - 1, func, arg);
+        else if (nodes[node].child != 0 || nodes[node].func != NULL)
+            printf("chord_insert: key %d / %d is bound already, ignored\n", modifiers,
+                   strokes[0].keysym);
+        else
+        {
+            nodes[node].func = func;
+            nodes[node].arg = arg;
+        }
+    }
+
+    free(keycodes);
+}
+
+static void chord_grab_key(const chord_node *node, bool grab)
+{
+    uint16_t locks[] = {0, numlockmask, XCB_MOD_MASK_LOCK, numlockmask | XCB_MOD_MASK_LOCK};
+
+    for (uint_fast8_t i = 0; i != LENGTH(locks); i++)
+    {
+        if (grab)
+            XERROR_TRACK(xcb_grab_key(c, 1, root, node->modifiers | locks[i], node->keycode,
+                                      XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC));
+        else
+            xcb_ungrab_key(c, node->keycode, root, node->modifiers | locks[i]);
+    }
+}
+
+/*
+ * Build the trie of the current bindings, the chord in progress is dropped.
+ * The keyboard mapping is fetched once, every keysym is looked up in it, and kept to tell modifier
+ * keys apart while a chord is in progress.
+ * The first keys are grabbed for good: only those that were not grabbed by the previous trie are,
+ * and those it no longer has are ungrabbed.
+ */
+void chord_compile()
+{
+    chord_cancel();
+
+    if (keysyms != NULL)
+        xcb_key_symbols_free(keysyms);
+
+    if ((keysyms = xcb_key_symbols_alloc(c)) == NULL)
+    {
+        perror("chord_compile");
+        exit(1);
+    }
+
+    chord_node *previous = nodes;
+    nodes_size = 64;
+    if ((nodes = malloc(nodes_size * sizeof(chord_node))) == NULL)
+    {
+        perror("chord_compile");
+        exit(1);
+    }
+
+    // The root, the first key of each binding follows it
+    nodes[0] = (chord_node){0};
+    nodes_length = 1;
+
+    for (uint_fast8_t i = 0; i != keys_length; i++)
+        chord_insert(keysyms, 0, &(Stroke){keys[i].modifiers, keys[i].keysym}, 1, keys[i].func,
+                     &keys[i].arg);
+
+    for (uint_fast8_t i = 0; i != chords_length; i++)
+    {
+        uint_fast8_t length = 0;
+        while (length != KEY_CHORD_MAX && chords[i].strokes[length].keysym != 0)
+            length++;
+
+        if (length != 0)
+            chord_insert(keysyms, 0, chords[i].strokes, length, chords[i].func,
+                         &chords[i].arg);
+    }
+
+    if (previous != NULL)
+        for (uint16_t child = previous[0].child; child != 0; child = previous[child].sibling)
+            if (chord_find(nodes, 0, previous[child].keycode, previous[child].modifiers) == 0)
+                chord_grab_key(&previous[child], false);
+
+    for (uint16_t child = nodes[0].child; child != 0; child = nodes[child].sibling)
+        if (previous == NULL ||
+            chord_find(previous, 0, nodes[child].keycode, nodes[child].modifiers) == 0)
+            chord_grab_key(&nodes[child], true);
+
+    free(previous);
+    printf("chord_compile: %" PRIuFAST16 " nodes\n", nodes_length);
+}
+
+void chord_press(xcb_key_press_event_t *event)
+{
+    uint16_t modifiers = CLEANMASK(event->state);
+    uint16_t node = chord_find(nodes, state, event->detail, modifiers);
+
+    // The modifiers of the previous stroke may still be held, as MOD after MOD + w
+    if (node == 0 && state != 0)
+        node = chord_find(nodes, state, event->detail, modifiers & ~nodes[state].modifiers);
+
+    // Not a key of the chord in progress: it is dropped, the key may start another binding
+    if (node == 0 && state != 0)
+    {
+        // Pressed on the way to the next stroke, as SHIFT is for SHIFT + 1
+        if (xcb_is_modifier_key(xcb_key_symbols_get_keysym(keysyms, event->detail, 0)))
+            return; // Nothing to be done
+
+        chord_cancel();
+        node = chord_find(nodes, 0, event->detail, modifiers);
+    }
+
+    // Unbound, or a prefix none of whose following keys has a keycode
+    if (node == 0 || (nodes[node].child == 0 && nodes[node].func == NULL))
+        return; // Nothing to be done
+
+    // A prefix, wait for the next key: every key press comes to kbgwm until the chord is over
+    if (nodes[node].child != 0)
+    {
+        if (state == 0)
+        {
+            // Should the grab fail, the chord is still dropped after the timeout
+            xcb_grab_keyboard_cookie_t grab = xcb_grab_keyboard(
+                c, 0, root, event->time, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
+            xcb_discard_reply(c, grab.sequence);
+        }
+
+        state = node;
+        deadline = chord_timeout != 0 ? chord_now() + chord_timeout : 0;
+        printf("chord_press: chord in progress\n");
+        return;
+    }
+
+    chord_cancel();
+    nodes[node].func(nodes[node].arg);
+}
+
+// Drop the chord in progress
+void chord_cancel()
+{
+    if (state == 0)
+        return; // Nothing to be done
+
+    xcb_ungrab_keyboard(c, XCB_CURRENT_TIME);
+    state = 0;
+    deadline = 0;
+}
+
+// Milliseconds until the chord in progress times out, -1 when there is no deadline, for poll()
+int chord_poll_timeout()
+{
+    if (deadline == 0)
+        return -1;
+
+    uint64_t now = chord_now();
+    if (deadline <= now)
+        return 0;
+
+    return deadline - now > INT_MAX ? INT_MAX : (int)(deadline - now);
+}
+
+void chord_expire()
+{
+    if (deadline == 0 || chord_now() < deadline)
+        return; // Nothing to be done
+
+    printf("chord_expire: chord dropped\n");
+    chord_cancel();
+}
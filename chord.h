@@ -0,0 +1,33 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <xcb/xcb.h>
+
+/*
+ * Key bindings, chords included, compiled into a trie keyed by keycode and modifiers: each key
+ * press follows one edge. Only the first key of each binding is grabbed for good, the whole
+ * keyboard is grabbed while a chord is in progress.
+ */
+
+void chord_compile();
+void chord_press(xcb_key_press_event_t *);
+void chord_cancel();
+int chord_poll_timeout();
+void chord_expire();
@@ -17,12 +17,25 @@
  */
 
 #include "client.h"
+#include "audit.h"
+#include "bar.h"
 #include "kbgwm.h"
+#include "layout.h"
+#include "overview.h"
+#include "pace.h"
+#include "ping.h"
+#include "places.h"
+#include "pool.h"
+#include "probes.h"
+#include "props.h"
+#include "rules.h"
 #include "xcbutils.h"
+#include "xerror.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <xcb/xcb_icccm.h>
 
 static inline int16_t int16_in_range(int16_t value, int16_t min, int16_t max)
@@ -45,6 +58,68 @@ static inline uint16_t uint16_in_range(uint16_t value, uint16_t min, uint16_t ma
         return value;
 }
 
+// Clients with a configure waiting for the end of the current event batch
+static client *dirty_clients = NULL;
+
+// Clients waiting for their properties
+static client *props_clients = NULL;
+
+// The stacking order changed since _NET_CLIENT_LIST_STACKING was last updated
+static bool stacking_changed = true;
+
+// The client a raised client goes right below, NULL for the top: fullscreen clients stay above the
+// others
+static client *client_stack_top(const client *client, uint_fast8_t workspace)
+{
+    struct client_t *above = NULL;
+
+    if (client->fullscreen)
+        return NULL;
+
+    for (struct client_t *other = stacks[workspace]; other != NULL; other = other->stack_below)
+    {
+        if (other == client)
+            continue;
+        if (!other->fullscreen)
+            break;
+        above = other;
+    }
+
+    return above;
+}
+
+// Put a client in the stacking order of a workspace, right below another one, on top for NULL
+static void client_stack_push(client *client, uint_fast8_t workspace, struct client_t *above)
+{
+    struct client_t *below = above == NULL ? stacks[workspace] : above->stack_below;
+    client->stack_above = above;
+    client->stack_below = below;
+
+    if (below != NULL)
+        below->stack_above = client;
+
+    if (above != NULL)
+        above->stack_below = client;
+    else
+        stacks[workspace] = client;
+
+    stacking_changed = true;
+}
+
+// Remove a client from the stacking order of a workspace
+static void client_stack_unlink(client *client, uint_fast8_t workspace)
+{
+    if (client->stack_below != NULL)
+        client->stack_below->stack_above = client->stack_above;
+
+    if (client->stack_above != NULL)
+        client->stack_above->stack_below = client->stack_below;
+    else
+        stacks[workspace] = client->stack_below;
+
+    stacking_changed = true;
+}
+
 // Add a client to the current workspace list
 void client_add(client *client)
 {
@@ -55,12 +130,17 @@ void client_add(client *client)
 void client_add_workspace(client *client, uint_fast8_t workspace)
 {
     assert(client != NULL);
-    assert(workspace < workspaces_length);
+    assert(workspace < workspaces_max);
+
+    // Created on demand
+    if (workspace >= workspaces_length)
+        workspaces_length = workspace + 1;
 
     if (workspaces[workspace] == NULL)
     {
         client->next = client;
         client->previous = client;
+        workspaces_occupied |= UINT64_C(1) << workspace;
     }
     else
     {
@@ -71,19 +151,81 @@ void client_add_workspace(client *client, uint_fast8_t workspace)
     }
 
     workspaces[workspace] = client;
+
+    // Clients come in on top, wherever the X server has them for now
+    client_stack_push(client, workspace, client_stack_top(client, workspace));
+    client->unstacked = true;
+
+    layout_add(client, workspace);
+}
+
+// Give a client its workspace, display it and focus it, as the rule matching it says
+static void client_place(client *new_client, const Rule *rule)
+{
+    new_client->unplaced = false;
+
+    if (rule != NULL && rule->width != 0)
+    {
+        new_client->x = rule->x;
+        new_client->y = rule->y;
+        new_client->width = rule->width;
+        new_client->height = rule->height;
+        client_sanitize_position(new_client);
+        client_sanitize_dimensions(new_client);
+        client_configure_defer(new_client, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+                                               XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT);
+    }
+
+    uint_fast8_t workspace = current_workspace;
+    if (rule != NULL && rule->workspace >= 0 && rule->workspace < workspaces_max)
+        workspace = rule->workspace;
+
+    client *focused = workspaces[workspace];
+    const bool focus = rule == NULL || rule->focus || focused == NULL;
+
+    // Display the client, unless it goes to a hidden workspace
+    if (workspace == current_workspace)
+        XERROR_TRACK(xcb_map_window(c, new_client->id));
+    else
+        XERROR_TRACK(xcb_unmap_window(c, new_client->id));
+
+    if (focus && workspace == current_workspace)
+        focus_unfocus();
+    else if (focus)
+        focus_unfocus_client(focused);
+
+    client_add_workspace(new_client, workspace);
+
+    if (rule != NULL && rule->maximized)
+        client_maximize(new_client);
+
+    // The client won't get the focus, it still goes below the fullscreen clients
+    if (!focus)
+    {
+        workspaces[workspace] = focused;
+        focus_unfocus_client(new_client);
+        if (workspace == current_workspace)
+            client_raise(new_client, workspace);
+    }
+    else if (workspace == current_workspace)
+        focus_apply();
 }
 
 void client_create(xcb_window_t id)
 {
     printf("client_create: id=%d\n", id);
+    PROBE2(client_create, id, current_workspace);
 
-    // Request the information for the window
-
+    // Only the geometry is waited for, the properties are fetched by the worker (props.c)
     xcb_get_geometry_reply_t *geometry =
-        xcb_get_geometry_reply(c, xcb_get_geometry_unchecked(c, id), NULL);
-    xcb_size_hints_t hints;
-    xcb_icccm_get_wm_normal_hints_reply(c, xcb_icccm_get_wm_normal_hints_unchecked(c, id), &hints,
-                                        NULL);
+        AUDIT_REPLY(xcb_get_geometry_reply(c, xcb_get_geometry_unchecked(c, id), NULL));
+
+    // The window is already gone
+    if (geometry == NULL)
+    {
+        printf("client_create: unable to retrieve the geometry\n");
+        return;
+    }
 
     client *new_client = emalloc(sizeof(client));
 
@@ -92,41 +234,228 @@ void client_create(xcb_window_t id)
     new_client->y = geometry->y;
     new_client->width = geometry->width;
     new_client->height = geometry->height;
+    client_size_hints(new_client, NULL);
     new_client->maximized = false;
-
-    const bool min_size = hints.flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE;
-    new_client->min_width = min_size ? hints.min_width : 0;
-    new_client->min_height = min_size ? hints.min_height : 0;
-
-    const bool max_size = hints.flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE;
-    new_client->max_width = max_size ? hints.max_width : INT32_MAX;
-    new_client->max_height = max_size ? hints.max_height : INT32_MAX;
+    new_client->fullscreen = false;
+    new_client->fullscreen_asked = false;
+    new_client->fullscreen_wanted = false;
+    new_client->states_length = 0;
+    new_client->bypass_compositor = BYPASS_COMPOSITOR_NONE;
+    new_client->bypass_set = false;
+    new_client->dirty = 0;
+    new_client->dirty_next = NULL;
+    new_client->requested = false;
+    new_client->tile_next = NULL;
+    new_client->tiled = false;
+    new_client->visual = 0;
+    new_client->damage = XCB_NONE;
+    new_client->thumbnail = XCB_NONE;
+    new_client->damaged = false;
+    new_client->ping = false;
+    new_client->hung = false;
+    new_client->pinged = 0;
+    new_client->ping_deadline = 0;
+    new_client->kill_deadline = 0;
+    new_client->pid_sequence = 0;
+    new_client->machine_sequence = 0;
+    new_client->timed = false;
+    new_client->hints_sequence = 0;
+    new_client->protocols_sequence = 0;
+    new_client->name_sequence = 0;
+    new_client->net_name_sequence = 0;
+    new_client->bypass_sequence = 0;
+    new_client->title[0] = '\0';
+    new_client->title_utf8 = false;
+    new_client->refreshing = false;
+    new_client->place = -1;
 
     client_sanitize_dimensions(new_client);
 
-    printf("new window: id=%d x=%d y=%d width=%d height=%d min_width=%d min_height=%d max_width=%d "
-           "max_height=%d\n",
-           id, new_client->x, new_client->y, new_client->width, new_client->height,
-           new_client->min_width, new_client->min_height, new_client->max_width,
-           new_client->max_height);
+    uint16_t value_mask =
+        XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH;
 
-    xcb_configure_window(
-        c, id, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH,
-        (uint32_t[]){new_client->width, new_client->height, border_width});
+    // Keep it out of the bar
+    if (new_client->y < bar_height)
+    {
+        new_client->y = bar_height;
+        value_mask |= XCB_CONFIG_WINDOW_Y;
+    }
 
-    // Display the client
-    xcb_map_window(c, new_client->id);
-    xcb_flush(c);
+    new_client->sent_x = geometry->x;
+    new_client->sent_y = geometry->y;
+    new_client->sent_width = geometry->width;
+    new_client->sent_height = geometry->height;
 
     free(geometry);
 
-    focus_unfocus();
-    client_add(new_client);
-    focus_apply();
+    printf("new window: id=%d x=%d y=%d width=%d height=%d\n", id, new_client->x, new_client->y,
+           new_client->width, new_client->height);
+
+    // Rules, the pool and the places need WM_CLASS, the client is placed once it is known
+    new_client->unplaced = rules_length != 0 || pool_size != 0 || places_active();
+
+    // Its geometry may still change then, it all goes in one configure sent with its placement
+    if (new_client->unplaced)
+        client_configure_defer(new_client, value_mask);
+    else
+    {
+        if (value_mask & XCB_CONFIG_WINDOW_Y)
+            xcb_configure_window(c, id, value_mask,
+                                 (uint32_t[]){new_client->y, new_client->width,
+                                              new_client->height, border_width});
+        else
+            xcb_configure_window(c, id, value_mask,
+                                 (uint32_t[]){new_client->width, new_client->height,
+                                              border_width});
+
+        new_client->sent_y = new_client->y;
+        new_client->sent_width = new_client->width;
+        new_client->sent_height = new_client->height;
+    }
+
+    // Track the pointer, a click focuses the client under it
+    xcb_change_window_attributes(c, id, XCB_CW_EVENT_MASK, (uint32_t[]){CLIENT_EVENT_MASK});
+
+    new_client->props_next = props_clients;
+    props_clients = new_client;
+
+    if (!new_client->unplaced)
+        client_place(new_client, NULL);
+
+    props_request(id);
+    xcb_flush(c);
 
     printf("client_create: done\n");
 }
 
+// Forget a client waiting for its properties, returns it
+static client *client_props_unlink(xcb_window_t id)
+{
+    for (client **p = &props_clients; *p != NULL; p = &(*p)->props_next)
+    {
+        if ((*p)->id == id)
+        {
+            client *client = *p;
+            *p = client->props_next;
+            return client;
+        }
+    }
+
+    return NULL;
+}
+
+// Set _NET_WM_STATE: the atoms the client set, fullscreen added when it is
+static void client_publish_state(client *client)
+{
+    xcb_atom_t states[PROPS_STATE_SIZE + 1];
+    memcpy(states, client->states, client->states_length * sizeof(xcb_atom_t));
+    uint_fast8_t length = client->states_length;
+
+    if (client->fullscreen)
+        states[length++] = net_wm_state_fullscreen;
+
+    if (length == 0)
+        XERROR_TRACK(xcb_delete_property(c, client->id, net_wm_state));
+    else
+        XERROR_TRACK(xcb_change_property(c, XCB_PROP_MODE_REPLACE, client->id, net_wm_state,
+                                         XCB_ATOM_ATOM, 32, length, states));
+}
+
+// Workspace holding a client, -1 when it is in none of them
+static int_fast16_t client_workspace(const client *client)
+{
+    for (uint64_t occupied = workspaces_occupied; occupied != 0; occupied &= occupied - 1)
+    {
+        uint_fast8_t workspace = __builtin_ctzll(occupied);
+        if (client_find_workspace(client->id, workspace) == client)
+            return workspace;
+    }
+
+    return -1;
+}
+
+static void client_set_fullscreen(client *client, uint_fast8_t workspace, bool fullscreen)
+{
+    if (fullscreen == client->fullscreen)
+        return; // Nothing to be done
+
+    if (fullscreen)
+        client_fullscreen(client, workspace);
+    else
+        client_unfullscreen(client);
+
+    // The other tiles take its space, or give it back
+    layout_dirty(workspace);
+}
+
+// The state the client mapped its window with, unless it asked for another one since
+static void client_initial_state(client *client, const props *props)
+{
+    bool fullscreen = client->fullscreen_asked ? client->fullscreen_wanted : props->fullscreen;
+    client->fullscreen_asked = false;
+
+    int_fast16_t workspace = client_workspace(client);
+    if (workspace != -1)
+        client_set_fullscreen(client, workspace, fullscreen);
+}
+
+// The properties of a new client arrived: apply its size hints, and place it if it was waiting
+void client_properties(const props *props)
+{
+    client *client = client_props_unlink(props->window);
+
+    // The window went away in the meantime
+    if (client == NULL)
+        return; // Nothing to be done
+
+    if (props->has_hints)
+        client_size_hints(client, &props->hints);
+
+    client->visual = props->visual;
+    client->ping = props->ping;
+    memcpy(client->states, props->states, props->states_length * sizeof(xcb_atom_t));
+    client->states_length = props->states_length;
+
+    // Made fullscreen before its properties arrived, the state it set is known only now
+    if (client->fullscreen && client->states_length != 0)
+        client_publish_state(client);
+    strcpy(client->title, props->title);
+    client->title_utf8 = props->title_utf8;
+
+    if (!client->unplaced)
+    {
+        overview_track(client);
+        client_initial_state(client, props);
+        return; // Nothing else to be done
+    }
+
+    const Rule *rule = NULL;
+    if (props->has_class)
+    {
+        // A pre-started terminal, it stays unmapped until it is handed out
+        if (pool_size != 0 && strcmp(props->instance_name, pool_instance) == 0 &&
+            pool_adopt(client, props->pid))
+        {
+            client->unplaced = false;
+            return;
+        }
+
+        rule = rule_find(props->class_name, props->instance_name,
+                         props->has_role ? props->role : NULL);
+        client->place = places_find(props->class_name);
+    }
+
+    // Where its application was last seen, for what the rule leaves open
+    Rule recalled;
+    if (places_recall(client->place, rule, &recalled))
+        rule = &recalled;
+
+    client_place(client, rule);
+    overview_track(client);
+    client_initial_state(client, props);
+    printf("client_properties: %d placed\n", client->id);
+}
+
 // Find a client in the current workspace list
 client *client_find(xcb_window_t id)
 {
@@ -135,9 +464,10 @@ client *client_find(xcb_window_t id)
 
 client *client_find_all_workspaces(xcb_window_t id)
 {
-    for (uint_fast8_t workspace = 0; workspace != workspaces_length; workspace++)
+    // Only the workspaces holding clients
+    for (uint64_t occupied = workspaces_occupied; occupied != 0; occupied &= occupied - 1)
     {
-        client *client = client_find_workspace(id, workspace);
+        client *client = client_find_workspace(id, __builtin_ctzll(occupied));
         if (client != NULL)
             return client;
     }
@@ -145,6 +475,16 @@ client *client_find_all_workspaces(xcb_window_t id)
     return NULL;
 }
 
+// Find a client waiting for its properties to be placed, it is in no workspace yet
+client *client_find_unplaced(xcb_window_t id)
+{
+    for (client *client = props_clients; client != NULL; client = client->props_next)
+        if (client->id == id && client->unplaced)
+            return client;
+
+    return NULL;
+}
+
 client *client_find_workspace(xcb_window_t id, uint_fast8_t workspace)
 {
     assert(workspace < workspaces_length);
@@ -174,8 +514,14 @@ client *client_remove_workspace(uint_fast8_t workspace)
     assert(workspaces[workspace] != NULL);
 
     client *client = workspaces[workspace];
+    client_stack_unlink(client, workspace);
+    layout_remove(client, workspace);
+
     if (client->next == client)
+    {
         workspaces[workspace] = NULL;
+        workspaces_occupied &= ~(UINT64_C(1) << workspace);
+    }
     else
     {
         client->previous->next = client->next;
@@ -186,15 +532,55 @@ client *client_remove_workspace(uint_fast8_t workspace)
     return client;
 }
 
+// Drop a pending configure, the client is going away
+static void client_configure_cancel(client *client)
+{
+    if (client->dirty == 0)
+        return; // Nothing to be done
+
+    for (struct client_t **p = &dirty_clients; *p != NULL; p = &(*p)->dirty_next)
+    {
+        if (*p == client)
+        {
+            *p = client->dirty_next;
+            break;
+        }
+    }
+
+    client->dirty = 0;
+    client->requested = false;
+}
+
 void client_remove_all_workspaces(xcb_window_t id)
 {
-    for (uint_fast8_t workspace = 0; workspace != workspaces_length; workspace++)
+    // The client may not have its properties yet
+    client *waiting = client_props_unlink(id);
+    if (waiting != NULL && waiting->unplaced)
+    {
+        client_configure_cancel(waiting);
+        return; // It is in no workspace
+    }
+
+    for (uint64_t occupied = workspaces_occupied; occupied != 0; occupied &= occupied - 1)
     {
+        uint_fast8_t workspace = __builtin_ctzll(occupied);
         client *client = client_find_workspace(id, workspace);
         if (client != NULL)
         {
+            client_configure_cancel(client);
+            client_stack_unlink(client, workspace);
+            layout_remove(client, workspace);
+            overview_forget(client);
+            ping_forget(client);
+            pace_forget(client);
+            places_save(client, workspace);
+            props_forget(client);
+
             if (client->next == client)
+            {
                 workspaces[workspace] = NULL;
+                workspaces_occupied &= ~(UINT64_C(1) << workspace);
+            }
             else
             {
                 client->previous->next = client->next;
@@ -214,8 +600,8 @@ void client_sanitize_position(client *client)
     if (client->x != x)
         client->x = x;
 
-    int16_t y =
-        int16_in_range(client->y, 0, screen->height_in_pixels - client->height - border_width_x2);
+    int16_t y = int16_in_range(client->y, bar_height,
+                               screen->height_in_pixels - client->height - border_width_x2);
     if (client->y != y)
         client->y = y;
 }
@@ -233,6 +619,237 @@ void client_sanitize_dimensions(client *client)
         client->height = height;
 }
 
+// Take new WM_NORMAL_HINTS (NULL for none), the client is resized if it no longer fits them
+void client_size_hints(client *client, const xcb_size_hints_t *hints)
+{
+    const uint32_t flags = hints != NULL ? hints->flags : 0;
+
+    const bool min_size = flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE;
+    client->min_width = min_size ? hints->min_width : 0;
+    client->min_height = min_size ? hints->min_height : 0;
+
+    const bool max_size = flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE;
+    client->max_width = max_size ? hints->max_width : INT32_MAX;
+    client->max_height = max_size ? hints->max_height : INT32_MAX;
+
+    // ICCCM 4.1.2.3: the minimum size stands in for a missing base size for the increments, not
+    // for the aspect ratio
+    const bool base_size = flags & XCB_ICCCM_SIZE_HINT_BASE_SIZE;
+    client->base_width = base_size ? hints->base_width : client->min_width;
+    client->base_height = base_size ? hints->base_height : client->min_height;
+    client->aspect_base_width = base_size ? hints->base_width : 0;
+    client->aspect_base_height = base_size ? hints->base_height : 0;
+
+    const bool resize_inc = flags & XCB_ICCCM_SIZE_HINT_P_RESIZE_INC;
+    client->width_inc = resize_inc && hints->width_inc > 0 ? hints->width_inc : 0;
+    client->height_inc = resize_inc && hints->height_inc > 0 ? hints->height_inc : 0;
+
+    const bool aspect = flags & XCB_ICCCM_SIZE_HINT_P_ASPECT && hints->min_aspect_num > 0 &&
+                        hints->min_aspect_den > 0 && hints->max_aspect_num > 0 &&
+                        hints->max_aspect_den > 0;
+    client->min_aspect_num = aspect ? hints->min_aspect_num : 0;
+    client->min_aspect_den = aspect ? hints->min_aspect_den : 0;
+    client->max_aspect_num = aspect ? hints->max_aspect_num : 0;
+    client->max_aspect_den = aspect ? hints->max_aspect_den : 0;
+
+    // Its geometry is decided by the layout, or it fills the screen
+    if (hints == NULL || client->maximized || client->fullscreen || client->tiled)
+        return; // Nothing else to be done
+
+    uint16_t width = client->width, height = client->height;
+    client_sanitize_dimensions(client);
+    if (client->width != width || client->height != height)
+        client_configure_defer(client, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT);
+}
+
+// Round the size down to the aspect ratio and the increments of the size hints, as a terminal
+// wants it resized by whole characters
+void client_apply_size_hints(client *client)
+{
+    int32_t width = client->width - client->aspect_base_width;
+    int32_t height = client->height - client->aspect_base_height;
+
+    if (width > 0 && height > 0 && client->max_aspect_den != 0)
+    {
+        // width / height within min_aspect and max_aspect
+        if ((int64_t)width * client->max_aspect_den > (int64_t)height * client->max_aspect_num)
+            width = (int64_t)height * client->max_aspect_num / client->max_aspect_den;
+        else if ((int64_t)width * client->min_aspect_den <
+                 (int64_t)height * client->min_aspect_num)
+            height = (int64_t)width * client->min_aspect_den / client->min_aspect_num;
+
+        client->width = client->aspect_base_width + width;
+        client->height = client->aspect_base_height + height;
+    }
+
+    width = client->width - client->base_width;
+    height = client->height - client->base_height;
+
+    if (width > 0 && client->width_inc != 0)
+        width -= width % client->width_inc;
+    if (height > 0 && client->height_inc != 0)
+        height -= height % client->height_inc;
+
+    if (width > 0)
+        client->width = client->base_width + width;
+    if (height > 0)
+        client->height = client->base_height + height;
+}
+
+// Queue a configure of the given fields, it will be sent by client_configure_flush() once the
+// current batch of events has been handled, so repeated changes only cost one request
+void client_configure_defer(client *client, uint16_t mask)
+{
+    assert(client != NULL);
+
+    if (client->dirty == 0)
+    {
+        client->dirty_next = dirty_clients;
+        dirty_clients = client;
+    }
+
+    client->dirty |= mask;
+}
+
+// Send the pending configures, called at the end of each event batch
+void client_configure_flush()
+{
+    client *unplaced = NULL;
+
+    while (dirty_clients != NULL)
+    {
+        client *client = dirty_clients;
+        dirty_clients = client->dirty_next;
+
+        // Kept for client_place(), its properties may still move it
+        if (client->unplaced)
+        {
+            client->dirty_next = unplaced;
+            unplaced = client;
+            continue;
+        }
+
+        // Only the fields the X server does not have yet, a maximized or fullscreen client keeps
+        // its geometry
+        uint16_t mask = client->maximized || client->fullscreen ? 0 : client->dirty;
+        if (client->x == client->sent_x)
+            mask &= ~XCB_CONFIG_WINDOW_X;
+        if (client->y == client->sent_y)
+            mask &= ~XCB_CONFIG_WINDOW_Y;
+        if (client->width == client->sent_width)
+            mask &= ~XCB_CONFIG_WINDOW_WIDTH;
+        if (client->height == client->sent_height)
+            mask &= ~XCB_CONFIG_WINDOW_HEIGHT;
+
+        uint32_t values[5];
+        uint_fast8_t i = 0;
+
+        if (mask & XCB_CONFIG_WINDOW_X)
+            values[i++] = client->sent_x = client->x;
+        if (mask & XCB_CONFIG_WINDOW_Y)
+            values[i++] = client->sent_y = client->y;
+        if (mask & XCB_CONFIG_WINDOW_WIDTH)
+            values[i++] = client->sent_width = client->width;
+        if (mask & XCB_CONFIG_WINDOW_HEIGHT)
+            values[i++] = client->sent_height = client->height;
+        if (mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+            values[i++] = border_width;
+
+        if (mask != 0)
+            XERROR_TRACK(xcb_configure_window(c, client->id, mask, values));
+
+        // The request ended up changing nothing: ICCCM still wants a ConfigureNotify
+        else if (client->requested)
+            xcb_send_configure_notify(client);
+
+        client->dirty = 0;
+        client->requested = false;
+    }
+
+    dirty_clients = unplaced;
+}
+
+// Raise a client of a workspace on top, below its fullscreen clients, unless it already is
+void client_raise(client *client, uint_fast8_t workspace)
+{
+    assert(client != NULL);
+
+    struct client_t *above = client_stack_top(client, workspace);
+    if (client->stack_above == above && !client->unstacked)
+        return; // Nothing to be done
+
+    if (client->stack_above != above)
+    {
+        client_stack_unlink(client, workspace);
+        client_stack_push(client, workspace, above);
+    }
+
+    if (above == NULL)
+        XERROR_TRACK(xcb_configure_window(c, client->id, XCB_CONFIG_WINDOW_STACK_MODE,
+                                          (uint32_t[]){XCB_STACK_MODE_ABOVE}));
+    else
+        XERROR_TRACK(xcb_configure_window(
+            c, client->id, XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
+            (uint32_t[]){above->id, XCB_STACK_MODE_BELOW}));
+    client->unstacked = false;
+}
+
+// Make the X server stack the clients of a workspace like the mirror does. Nothing is sent unless
+// a client came in while the workspace was hidden, then each client is stacked right above the
+// one below it.
+void client_restack_workspace(uint_fast8_t workspace)
+{
+    client *bottom = NULL;
+    bool unstacked = false;
+
+    for (client *client = stacks[workspace]; client != NULL; client = client->stack_below)
+    {
+        unstacked |= client->unstacked;
+        bottom = client;
+    }
+
+    if (!unstacked)
+        return; // Nothing to be done
+
+    bottom->unstacked = false;
+
+    for (client *client = bottom->stack_above; client != NULL; client = client->stack_above)
+    {
+        XERROR_TRACK(xcb_configure_window(
+            c, client->id, XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
+            (uint32_t[]){client->stack_below->id, XCB_STACK_MODE_ABOVE}));
+        client->unstacked = false;
+    }
+}
+
+// Update _NET_CLIENT_LIST_STACKING if the stacking order changed, bottom to top, the current
+// workspace being on top of the others
+void client_stacking_publish()
+{
+    if (!stacking_changed)
+        return; // Nothing to be done
+
+    uint_fast32_t length = 0;
+    for (uint_fast8_t workspace = 0; workspace != workspaces_length; workspace++)
+        for (client *client = stacks[workspace]; client != NULL; client = client->stack_below)
+            length++;
+
+    xcb_window_t *windows = emalloc((length + 1) * sizeof(xcb_window_t));
+    uint_fast32_t i = length;
+
+    for (uint_fast8_t j = 0; j != workspaces_length; j++)
+    {
+        uint_fast8_t workspace = j == 0 ? current_workspace : j <= current_workspace ? j - 1 : j;
+        for (client *client = stacks[workspace]; client != NULL; client = client->stack_below)
+            windows[--i] = client->id;
+    }
+
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, root, net_client_list_stacking, XCB_ATOM_WINDOW,
+                        32, length, windows);
+    free(windows);
+    stacking_changed = false;
+}
+
 void client_kill(__attribute__((unused)) const Arg *arg)
 {
     printf("=======[ user action: client_kill ]=======\n");
@@ -241,10 +858,18 @@ void client_kill(__attribute__((unused)) const Arg *arg)
     if (workspaces[current_workspace] == NULL)
         return; // Nothing to be done
 
-    if (!xcb_send_atom(workspaces[current_workspace], wm_delete_window))
+    client *client = workspaces[current_workspace];
+    PROBE1(client_kill, client->id);
+
+    // Asked to close already, ping_kill() does not wait this time
+    if (client->kill_deadline != 0)
+        ping_kill(client);
+    else if (xcb_send_atom(client, wm_delete_window))
+        ping_kill(client);
+    else
     {
         // The client does not support WM_DELETE, let's kill it
-        xcb_kill_client(c, workspaces[current_workspace]->id);
+        XERROR_TRACK(xcb_kill_client(c, client->id));
     }
 
     xcb_flush(c);
@@ -260,11 +885,18 @@ void client_toggle_maximize(__attribute__((unused)) const Arg *arg)
 
     client *client = workspaces[current_workspace];
 
+    // Left as it is until it leaves fullscreen
+    if (client->fullscreen)
+        return; // Nothing to be done
+
     if (client->maximized)
         client_unmaximize(client);
     else
         client_maximize(client);
 
+    // The other tiles take its space, or give it back
+    layout_dirty(current_workspace);
+
     xcb_flush(c);
 }
 
@@ -274,9 +906,14 @@ void client_maximize(client *client)
     assert(!client->maximized);
 
     client->maximized = true;
+    client->sent_x = 0;
+    client->sent_y = bar_height;
+    client->sent_width = screen->width_in_pixels;
+    client->sent_height = screen->height_in_pixels - bar_height;
 
-    uint32_t values[] = {0, 0, screen->width_in_pixels, screen->height_in_pixels, 0};
-    xcb_configure_window(c, focused_client->id,
+    uint32_t values[] = {0, bar_height, screen->width_in_pixels,
+                         screen->height_in_pixels - bar_height, 0};
+    xcb_configure_window(c, client->id,
                          XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
                              XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH,
                          values);
@@ -288,41 +925,136 @@ void client_unmaximize(client *client)
     assert(client->maximized);
 
     client->maximized = false;
+    client->sent_x = client->x;
+    client->sent_y = client->y;
+    client->sent_width = client->width;
+    client->sent_height = client->height;
 
     uint32_t values[] = {client->x, client->y, client->width, client->height, border_width};
-    xcb_configure_window(c, focused_client->id,
+    xcb_configure_window(c, client->id,
                          XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
                              XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH,
                          values);
 }
 
-void client_grab_buttons(client *client, bool focused)
+void client_toggle_fullscreen(__attribute__((unused)) const Arg *arg)
 {
-    xcb_ungrab_button(c, XCB_BUTTON_INDEX_ANY, client->id, XCB_MOD_MASK_ANY);
+    printf("=======[ user action: client_toggle_fullscreen ]=======\n");
 
-    // The client is not the focused one -> grab everything
-    if (!focused)
-    {
-        xcb_grab_button(c, 1, client->id, BUTTON_EVENT_MASK, XCB_GRAB_MODE_ASYNC,
-                        XCB_GRAB_MODE_ASYNC, root, XCB_NONE, XCB_BUTTON_INDEX_ANY,
-                        XCB_MOD_MASK_ANY);
-    }
+    // No client are focused
+    if (workspaces[current_workspace] == NULL)
+        return; // Nothing to be done
+
+    client *client = workspaces[current_workspace];
 
-    // The client is the focused one -> grab only the configured buttons
+    if (client->fullscreen)
+        client_unfullscreen(client);
     else
+        client_fullscreen(client, current_workspace);
+
+    // The other tiles take its space, or give it back
+    layout_dirty(current_workspace);
+
+    xcb_flush(c);
+}
+
+// _NET_WM_STATE_FULLSCREEN asked by a client: 0 remove, 1 add, 2 toggle. A client waiting for its
+// properties to be placed gets it with them.
+void client_request_fullscreen(xcb_window_t id, uint32_t action)
+{
+    for (uint64_t occupied = workspaces_occupied; occupied != 0; occupied &= occupied - 1)
     {
-        for (uint_fast8_t i = 0; i != buttons_length; i++)
+        uint_fast8_t workspace = __builtin_ctzll(occupied);
+        client *client = client_find_workspace(id, workspace);
+        if (client != NULL)
         {
-            uint16_t modifiers[] = {0, numlockmask, XCB_MOD_MASK_LOCK,
-                                    numlockmask | XCB_MOD_MASK_LOCK};
-            Button button = buttons[i];
+            // Its properties may still be on their way, with an older state
+            client->fullscreen_wanted = action == 2 ? !client->fullscreen : action == 1;
+            client->fullscreen_asked = true;
+            client_set_fullscreen(client, workspace, client->fullscreen_wanted);
+            return;
+        }
+    }
 
-            for (uint_fast8_t j = 0; j != LENGTH(modifiers); j++)
-            {
-                xcb_grab_button(c, 0, client->id, BUTTON_EVENT_MASK, XCB_GRAB_MODE_ASYNC,
-                                XCB_GRAB_MODE_ASYNC, root, XCB_NONE, button.keysym,
-                                button.modifiers | modifiers[j]);
-            }
+    for (client *client = props_clients; client != NULL; client = client->props_next)
+    {
+        if (client->id == id)
+        {
+            client->fullscreen_wanted = action == 2 ? !client->fullscreen_wanted : action == 1;
+            client->fullscreen_asked = true;
+            return;
         }
     }
 }
+
+// Cover the whole screen, the bar included, on top of the other clients of its workspace: they are
+// raised below it. Moves, resizes and ConfigureRequests leave it alone until client_unfullscreen().
+void client_fullscreen(client *client, uint_fast8_t workspace)
+{
+    assert(client != NULL);
+    assert(!client->fullscreen);
+    PROBE1(client_fullscreen, client->id);
+
+    // Fullscreen takes over, leaving it gets back the geometry from before maximizing
+    client->maximized = false;
+    client->fullscreen = true;
+    client->sent_x = 0;
+    client->sent_y = 0;
+    client->sent_width = screen->width_in_pixels;
+    client->sent_height = screen->height_in_pixels;
+
+    uint32_t values[] = {0, 0, screen->width_in_pixels, screen->height_in_pixels, 0};
+    xcb_configure_window(c, client->id,
+                         XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
+                             XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH,
+                         values);
+    client_raise(client, workspace);
+
+    client_publish_state(client);
+
+    // Whether the client wants to stay composited, client_bypass_compositor() gets the answer
+    props_refresh(client, net_wm_bypass_compositor);
+}
+
+void client_unfullscreen(client *client)
+{
+    assert(client != NULL);
+    assert(client->fullscreen);
+
+    client->fullscreen = false;
+    client->sent_x = client->x;
+    client->sent_y = client->y;
+    client->sent_width = client->width;
+    client->sent_height = client->height;
+
+    uint32_t values[] = {client->x, client->y, client->width, client->height, border_width};
+    xcb_configure_window(c, client->id,
+                         XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
+                             XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH,
+                         values);
+
+    client_publish_state(client);
+    if (client->bypass_set)
+        XERROR_TRACK(xcb_delete_property(c, client->id, net_wm_bypass_compositor));
+    client->bypass_set = false;
+
+    // Back below the clients still fullscreen
+    int_fast16_t workspace = client_workspace(client);
+    if (workspace != -1)
+        client_raise(client, workspace);
+}
+
+// _NET_WM_BYPASS_COMPOSITOR of a fullscreen client. Without a preference, compositors are told
+// it can be unredirected, overview_bypass() does the same for the redirection of kbgwm.
+void client_bypass_compositor(client *client, uint32_t bypass)
+{
+    client->bypass_compositor = bypass;
+
+    if (!client->fullscreen || bypass != BYPASS_COMPOSITOR_NONE || client->bypass_set)
+        return; // Nothing else to be done
+
+    XERROR_TRACK(xcb_change_property(c, XCB_PROP_MODE_REPLACE, client->id,
+                                     net_wm_bypass_compositor, XCB_ATOM_CARDINAL, 32, 1,
+                                     (uint32_t[]){BYPASS_COMPOSITOR_ON}));
+    client->bypass_set = true;
+}
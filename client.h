@@ -18,9 +18,16 @@
 
 #pragma once
 
+#include "props.h"
+#include "snapshot.h"
 #include "types.h"
 #include <stdbool.h>
 
+// _NET_WM_BYPASS_COMPOSITOR values
+#define BYPASS_COMPOSITOR_NONE 0 // No preference
+#define BYPASS_COMPOSITOR_ON 1
+#define BYPASS_COMPOSITOR_OFF 2 // The client wants to stay composited
+
 typedef struct client_t client;
 struct client_t
 {
@@ -29,23 +36,86 @@ struct client_t
     uint16_t width, height;
     int32_t min_width, min_height;
     int32_t max_width, max_height;
+    int32_t base_width, base_height;      // Size hints honoured by mouseresize
+    int32_t aspect_base_width, aspect_base_height; // 0 without a base size
+    int32_t width_inc, height_inc;        // 0 for none
+    int32_t min_aspect_num, min_aspect_den; // 0 for none
+    int32_t max_aspect_num, max_aspect_den;
     bool maximized;
+    bool fullscreen;               // _NET_WM_STATE_FULLSCREEN: no border, no move, no resize
+    bool fullscreen_asked;         // _NET_WM_STATE message received, it takes precedence over
+    bool fullscreen_wanted;        // the property fetched with its props
+    xcb_atom_t states[PROPS_STATE_SIZE]; // _NET_WM_STATE atoms other than fullscreen, left as the
+    uint8_t states_length;               // client set them
+    uint32_t bypass_compositor;    // BYPASS_COMPOSITOR_*, only fetched while fullscreen
+    bool bypass_set;               // kbgwm set _NET_WM_BYPASS_COMPOSITOR for the client
+    uint16_t dirty; // XCB_CONFIG_WINDOW_* fields waiting for client_configure_flush()
+    client *dirty_next;
+    bool requested; // A ConfigureRequest waits for client_configure_flush() to be answered
+    int16_t sent_x, sent_y; // Geometry the X server has, the last one configured
+    uint16_t sent_width, sent_height;
+    client *stack_above; // Stacking order of the workspace, NULL at the top
+    client *stack_below; // NULL at the bottom
+    bool unstacked;      // The X server may not stack the client where the mirror does
+    client *props_next;  // Next client waiting for its properties
+    unsigned int hints_sequence, protocols_sequence; // Refetches of changed properties, or 0
+    unsigned int name_sequence, net_name_sequence;   // WM_NAME and _NET_WM_NAME, for snapshots
+    unsigned int bypass_sequence;                    // _NET_WM_BYPASS_COMPOSITOR
+    bool refreshing;                                 // Has a refetch on its way
+    client *refreshing_next;
+    bool unplaced;       // Waiting for its properties to get a workspace
+    int16_t place;       // Slot of its WM_CLASS in the places file (places.h), -1 for none
+    client *tile_next;   // Tiling order of the workspace
+    bool tiled;          // Its geometry is decided by the layout of its workspace
+    int16_t float_x, float_y; // Geometry before it was tiled
+    uint16_t float_width, float_height;
+    xcb_visualid_t visual;
+    uint32_t damage;            // Damage object, XCB_NONE while the overview does not follow it
+    uint32_t window_picture;    // The window, scaled down to the overview
+    uint32_t thumbnail;         // Pixmap of the last rendering, XCB_NONE before the first one
+    uint32_t thumbnail_picture;
+    uint16_t thumbnail_width, thumbnail_height;
+    bool damaged;               // Waiting for overview_refresh()
+    client *damaged_next;
+    bool ping;                  // Supports _NET_WM_PING
+    bool hung;                  // Did not answer the last ping in time
+    uint64_t pinged;            // When the last ping was sent (milliseconds), 0 before the first
+    uint64_t ping_deadline;     // The last ping is waited for until then, 0 once answered
+    uint64_t kill_deadline;     // Killed then if it does not answer, 0 when not asked to close
+    unsigned int pid_sequence, machine_sequence; // _NET_WM_PID and WM_CLIENT_MACHINE, if closing
+    bool timed;                 // Has a deadline
+    client *timed_next;
+    char title[SNAPSHOT_TITLE_SIZE]; // Only kept for the snapshot (snapshot.h), empty otherwise
+    bool title_utf8;                 // Has a _NET_WM_NAME, WM_NAME is ignored
     client *previous;
     client *next;
 };
 
-void client_grab_buttons(client *, bool);
 void client_kill(const Arg *);
 void client_create(xcb_window_t);
+void client_properties(const props *);
 void client_toggle_maximize(const Arg *);
+void client_toggle_fullscreen(const Arg *);
 client *client_remove();
 void client_add_workspace(client *, uint_fast8_t);
 client *client_remove_workspace(uint_fast8_t);
 client *client_find(xcb_window_t);
 void client_maximize(client *);
 void client_unmaximize(client *);
+void client_fullscreen(client *, uint_fast8_t);
+void client_unfullscreen(client *);
+void client_request_fullscreen(xcb_window_t, uint32_t);
+void client_bypass_compositor(client *, uint32_t);
 void client_sanitize_position(client *);
 void client_sanitize_dimensions(client *);
+void client_size_hints(client *, const xcb_size_hints_t *);
+void client_apply_size_hints(client *);
+void client_configure_defer(client *, uint16_t);
+void client_configure_flush();
+void client_raise(client *, uint_fast8_t);
+void client_restack_workspace(uint_fast8_t);
+void client_stacking_publish();
 void client_remove_all_workspaces(xcb_window_t);
 client *client_find_all_workspaces(xcb_window_t);
 client *client_find_workspace(xcb_window_t, uint_fast8_t);
+client *client_find_unplaced(xcb_window_t);
@@ -25,18 +25,108 @@
 #define MODKEY XCB_MOD_MASK_1
 #define SHIFT XCB_MOD_MASK_SHIFT
 
+/*
+ * Everything below is the default configuration, the runtime configuration file (see README)
+ * overrides the colors, the border width, the kill timeout, the number of workspaces and the
+ * bindings
+ */
+
 #define FOCUS_COLOR 0xFF0000
 #define UNFOCUS_COLOR 0x005577
 
 #define BORDER_WIDTH 1
 
+/*
+ * Hung clients
+ * The focused client is pinged (_NET_WM_PING) at most every PING_INTERVAL milliseconds, one that
+ * does not answer within PING_TIMEOUT milliseconds gets a HUNG_COLOR border until it does.
+ * A client asked to close (client_kill) that is still there KILL_TIMEOUT milliseconds later and
+ * does not answer pings is killed: SIGKILL through _NET_WM_PID when it runs on this machine, and
+ * its connection closed. Asking it to close a second time kills it right away.
+ */
+#define HUNG_COLOR 0xFF8800
+#define PING_INTERVAL 10000
+#define PING_TIMEOUT 1000
+#define KILL_TIMEOUT 3000
+
+/*
+ * Mouse move/resize (mousemove, mouseresize)
+ * The window follows the pointer once per displayed frame, at the vblank reported by the Present
+ * extension. Without Present, a timer paces it PACE_RATE times a second (0 for every batch).
+ */
+#define PACE_RATE 60
+
+/*
+ * Keyboard move/resize (keymove, keyresize)
+ * Each nudge moves the window by NUDGE_STEP pixels, when the same key is repeated within
+ * NUDGE_REPEAT_DELAY milliseconds the step grows by NUDGE_STEP, up to NUDGE_STEP_MAX
+ */
+#define NUDGE_STEP 8
+#define NUDGE_STEP_MAX 128
+#define NUDGE_REPEAT_DELAY 100
+
+/*
+ * Built-in bar, at the top of the screen, off by default: the windows are kept below it
+ * The status is the WM_NAME of the root window, set it with xsetroot -name
+ */
+#define BAR false
+#define BAR_FONT "fixed"
+#define BAR_FOREGROUND 0xBBBBBB
+#define BAR_BACKGROUND 0x222222
+
+/*
+ * Overview of every workspace (MOD+o), clicking one switches to it
+ * Needs the Composite, Damage and Render extensions. Off by default: every window is then
+ * redirected from startup on, and copied by the X server each time it is drawn.
+ */
+#define OVERVIEW false
+
+/*
+ * Tiling layouts (MOD+t master and stack, MOD+g grid, MOD+s floating), chosen per workspace
+ * The master tile takes MASTER_SIZE percent of the screen width
+ */
+#define MASTER_SIZE 55
+
+/*
+ * Remember the geometry and workspace of the last window of each application (WM_CLASS), in
+ * $XDG_STATE_HOME/kbgwm/places, and give them to its next window. Rules take precedence.
+ * Off by default.
+ */
+#define PLACES false
+
+/*
+ * Publish the workspaces, their windows (geometry and title) and the focus in
+ * $XDG_RUNTIME_DIR/kbgwm/snapshot for bars and scripts, see snapshot.h
+ */
+#define SNAPSHOT true
+
+/*
+ * Chords (default_chords), bindings of several successive key presses
+ * The keyboard is grabbed while a chord is in progress: it is dropped when a key that does not
+ * follow is pressed, modifier keys aside, or when no key follows within CHORD_TIMEOUT milliseconds
+ * (0 waits for the next key)
+ */
+#define CHORD_TIMEOUT 2000
+
 /*
  * Number of workspaces
- * They will be numbered from 0 to NB_WORKSPACES-1
+ * Workspaces 0 to NB_WORKSPACES-1 always exist, the others are created when a window is sent there
+ * and go away once empty, up to WORKSPACES_MAX (at most 64)
  */
 #define NB_WORKSPACES 10
+#define WORKSPACES_MAX 64
+
+/*
+ * Warm terminal pool
+ * POOL_SIZE terminals are started in advance and kept hidden, MOD+Return shows one of them instead
+ * of starting a new one. They are recognized by their WM_CLASS instance, POOL_INSTANCE, which
+ * poolcmd must set, and by their _NET_WM_PID when they set it. Disabled (0) by default.
+ */
+#define POOL_SIZE 0
+#define POOL_INSTANCE "kbgwm-pool"
 
 static const char *termcmd[] = {"xterm", NULL};
+static const char *poolcmd[] = {"xterm", "-name", POOL_INSTANCE, NULL};
 static const char *menucmd[] = {"dmenu_run", NULL};
 
 // clang-format off
@@ -44,16 +134,33 @@ static const char *menucmd[] = {"dmenu_run", NULL};
 	{ MODKEY|XCB_MOD_MASK_SHIFT, KEY, workspace_send,   {.i = WORKSPACE} }, \
 	{ MODKEY,                    KEY, workspace_change, {.i = WORKSPACE} },
 
-const Key keys[] = {
-	{ MODKEY,         XK_Return,    start,                  { .cmd = termcmd } },
-	{ MODKEY,         XK_p,         start,                  { .cmd = menucmd } },
-	{ MODKEY,         XK_Page_Up,   workspace_previous,     { 0 } },
-	{ MODKEY,         XK_Page_Down, workspace_next,         { 0 } },
-	{ MODKEY | SHIFT, XK_Tab,       focus_next,             { .b = true } },
-	{ MODKEY,         XK_Tab,       focus_next,             { .b = false } },
-	{ MODKEY,         XK_q,         client_kill,            { 0 } },
-	{ MODKEY | SHIFT, XK_q,         quit,                   { 0 } },
-	{ MODKEY,         XK_x,         client_toggle_maximize, { 0 } },
+const Key default_keys[] = {
+	{ MODKEY,         XK_Return,    terminal,                    { .cmd = termcmd } },
+	{ MODKEY,         XK_p,         start,                       { .cmd = menucmd } },
+	{ MODKEY,         XK_Page_Up,   workspace_previous,          { 0 } },
+	{ MODKEY,         XK_Page_Down, workspace_next,              { 0 } },
+	{ MODKEY,         XK_n,         workspace_next_occupied,     { 0 } },
+	{ MODKEY | SHIFT, XK_n,         workspace_previous_occupied, { 0 } },
+	{ MODKEY,         XK_e,         workspace_free,              { 0 } },
+	{ MODKEY | SHIFT, XK_e,         workspace_send_free,         { 0 } },
+	{ MODKEY | SHIFT, XK_Tab,       focus_next,                  { .b = true } },
+	{ MODKEY,         XK_Tab,       focus_next,                  { .b = false } },
+	{ MODKEY,         XK_q,         client_kill,                 { 0 } },
+	{ MODKEY | SHIFT, XK_q,         quit,                        { 0 } },
+	{ MODKEY,         XK_x,         client_toggle_maximize,      { 0 } },
+	{ MODKEY,         XK_f,         client_toggle_fullscreen,    { 0 } },
+	{ MODKEY,         XK_o,         overview,                    { 0 } },
+	{ MODKEY,         XK_t,         layout,                      { .i = LAYOUT_MASTER } },
+	{ MODKEY,         XK_g,         layout,                      { .i = LAYOUT_GRID } },
+	{ MODKEY,         XK_s,         layout,                      { .i = LAYOUT_FLOATING } },
+	{ MODKEY,         XK_Left,      keymove,                     { .i = DIRECTION_LEFT } },
+	{ MODKEY,         XK_Right,     keymove,                     { .i = DIRECTION_RIGHT } },
+	{ MODKEY,         XK_Up,        keymove,                     { .i = DIRECTION_UP } },
+	{ MODKEY,         XK_Down,      keymove,                     { .i = DIRECTION_DOWN } },
+	{ MODKEY | SHIFT, XK_Left,      keyresize,                   { .i = DIRECTION_LEFT } },
+	{ MODKEY | SHIFT, XK_Right,     keyresize,                   { .i = DIRECTION_RIGHT } },
+	{ MODKEY | SHIFT, XK_Up,        keyresize,                   { .i = DIRECTION_UP } },
+	{ MODKEY | SHIFT, XK_Down,      keyresize,                   { .i = DIRECTION_DOWN } },
 	WORKSPACEKEYS(XK_Home, 0)
 	WORKSPACEKEYS(XK_1, 0)
 	WORKSPACEKEYS(XK_2, 1)
@@ -68,14 +175,78 @@ const Key keys[] = {
 	WORKSPACEKEYS(XK_End, 9)
 };
 
-const Button buttons[] = {
+// MOD+w then a digit switches to workspaces 10 to 19, MOD+SHIFT+w then a digit sends there. The
+// modifiers of the first stroke may still be held for the second one.
+#define CHORDWORKSPACEKEYS(KEY,WORKSPACE) \
+	{ { { MODKEY | SHIFT, XK_w }, { 0, KEY } }, workspace_send,   {.i = WORKSPACE} }, \
+	{ { { MODKEY,         XK_w }, { 0, KEY } }, workspace_change, {.i = WORKSPACE} },
+
+const Chord default_chords[] = {
+	CHORDWORKSPACEKEYS(XK_0, 10)
+	CHORDWORKSPACEKEYS(XK_1, 11)
+	CHORDWORKSPACEKEYS(XK_2, 12)
+	CHORDWORKSPACEKEYS(XK_3, 13)
+	CHORDWORKSPACEKEYS(XK_4, 14)
+	CHORDWORKSPACEKEYS(XK_5, 15)
+	CHORDWORKSPACEKEYS(XK_6, 16)
+	CHORDWORKSPACEKEYS(XK_7, 17)
+	CHORDWORKSPACEKEYS(XK_8, 18)
+	CHORDWORKSPACEKEYS(XK_9, 19)
+};
+
+// None by default, the last entry only marks the end of the table
+const Rule default_rules[] = {
+	/* class       instance  role  workspace  x  y  width  height  maximized  focus */
+	// { "Gimp",      NULL,     NULL, -1,        0, 0, 0,     0,      true,      true },
+	// { "Firefox",   NULL,     NULL, 8,         0, 0, 0,     0,      false,     false },
+	{ 0 },
+};
+
+const Button default_buttons[] = {
 	{ MODKEY, XCB_BUTTON_INDEX_1, mousemove,   { 0 } },
 	{ MODKEY, XCB_BUTTON_INDEX_3, mouseresize, { 0 } },
 };
 // clang-format on
 
-const uint_least8_t keys_length = LENGTH(keys);
-const uint_least8_t buttons_length = LENGTH(buttons);
-const uint_least8_t workspaces_length = NB_WORKSPACES;
-const uint_least8_t border_width = BORDER_WIDTH;
-const uint_least8_t border_width_x2 = (border_width << 1);
+const uint_least8_t default_keys_length = LENGTH(default_keys);
+const uint_least8_t default_chords_length = LENGTH(default_chords);
+const uint_least8_t default_buttons_length = LENGTH(default_buttons);
+const uint_least8_t workspaces_max = WORKSPACES_MAX;
+const uint_least8_t default_workspaces_min = NB_WORKSPACES;
+const uint32_t default_focus_color = FOCUS_COLOR;
+const uint32_t default_unfocus_color = UNFOCUS_COLOR;
+const uint32_t default_hung_color = HUNG_COLOR;
+const uint32_t ping_interval = PING_INTERVAL;
+const uint32_t ping_timeout = PING_TIMEOUT;
+const uint32_t default_kill_timeout = KILL_TIMEOUT;
+const uint_least8_t default_border_width = BORDER_WIDTH;
+const bool bar_enabled = BAR;
+const char *bar_font = BAR_FONT;
+const uint32_t bar_foreground = BAR_FOREGROUND;
+const uint32_t bar_background = BAR_BACKGROUND;
+const bool overview_enabled = OVERVIEW;
+const uint_least8_t master_size = MASTER_SIZE;
+const bool places_enabled = PLACES;
+const bool snapshot_enabled = SNAPSHOT;
+const uint32_t chord_timeout = CHORD_TIMEOUT;
+const uint_least16_t pace_rate = PACE_RATE;
+
+const Key *keys = default_keys;
+const Chord *chords = default_chords;
+const Button *buttons = default_buttons;
+const Rule *rules = default_rules;
+uint_least8_t rules_length = LENGTH(default_rules) - 1;
+uint_least8_t keys_length = LENGTH(default_keys);
+uint_least8_t chords_length = LENGTH(default_chords);
+uint_least8_t buttons_length = LENGTH(default_buttons);
+uint32_t focus_color = FOCUS_COLOR;
+uint32_t unfocus_color = UNFOCUS_COLOR;
+uint32_t hung_color = HUNG_COLOR;
+uint32_t kill_timeout = KILL_TIMEOUT;
+const uint_least8_t pool_size = POOL_SIZE;
+const char *pool_instance = POOL_INSTANCE;
+const char **pool_cmd = poolcmd;
+uint_least8_t workspaces_min = NB_WORKSPACES;
+uint_least8_t workspaces_length = NB_WORKSPACES;
+uint_least8_t border_width = BORDER_WIDTH;
+uint_least8_t border_width_x2 = BORDER_WIDTH << 1;
@@ -17,36 +17,59 @@
  */
 
 #include "events.h"
+#include "audit.h"
+#include "bar.h"
+#include "chord.h"
 #include "client.h"
 #include "kbgwm.h"
+#include "layout.h"
+#include "overview.h"
+#include "pace.h"
+#include "ping.h"
+#include "pool.h"
+#include "probes.h"
+#include "props.h"
+#include "rc.h"
+#include "snapshot.h"
 #include "xcbutils.h"
+#include "xerror.h"
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xinput.h>
 
 #define CLEANMASK(mask) (mask & ~(numlockmask | XCB_MOD_MASK_LOCK))
 
-#define EVENT_HANDLERS_SIZE XCB_CONFIGURE_REQUEST + 1
+#define EVENT_HANDLERS_SIZE XCB_GE_GENERIC + 1
 static void (*event_handlers[EVENT_HANDLERS_SIZE])(xcb_generic_event_t *);
 
+// Major opcode of XInput, 0 when XInput 2.2 is not available
+static uint8_t xinput_opcode = 0;
+
+// The client under the pointer, the one a click focuses
+static xcb_window_t pointer_window = XCB_NONE;
+
 static void handle_key_press(xcb_generic_event_t *e)
 {
     xcb_key_press_event_t *event = (xcb_key_press_event_t *)e;
-    xcb_keysym_t keysym = xcb_get_keysym(event->detail);
+    PROBE2(key_press, event->detail, event->state);
+    event_time = event->time;
 
-    for (uint_fast8_t i = 0; i < keys_length; i++)
-    {
-        if (keysym == keys[i].keysym && CLEANMASK(keys[i].modifiers) == CLEANMASK(event->state))
-        {
-            keys[i].func(&keys[i].arg);
-            break;
-        }
-    }
+    chord_press(event);
 }
 
 static void handle_button_press(xcb_generic_event_t *e)
 {
     xcb_button_press_event_t *event = (xcb_button_press_event_t *)e;
+    PROBE2(button_press, event->child, event->detail);
+
+    if (event->event == overview_window)
+    {
+        overview_click(event);
+        return;
+    }
 
     // Click on the root window
     if (event->event == event->root && event->child == 0)
@@ -57,8 +80,10 @@ static void handle_button_press(xcb_generic_event_t *e)
     // The window clicked is not the one in focus, we have to focus it
     if (workspaces[current_workspace] == NULL || window != workspaces[current_workspace]->id)
     {
+        // Buttons are grabbed on the root window, the click may be on an unmanaged window
         client *client = client_find(window);
-        assert(client != NULL);
+        if (client == NULL)
+            return; // Nothing to be done
 
         focus_unfocus();
         workspaces[current_workspace] = client;
@@ -79,12 +104,72 @@ static void handle_button_press(xcb_generic_event_t *e)
     }
 }
 
+static void handle_enter_notify(xcb_generic_event_t *e)
+{
+    xcb_enter_notify_event_t *event = (xcb_enter_notify_event_t *)e;
+    PROBE1(enter_notify, event->event);
+    pointer_window = event->event;
+}
+
+static void handle_leave_notify(xcb_generic_event_t *e)
+{
+    xcb_leave_notify_event_t *event = (xcb_leave_notify_event_t *)e;
+    PROBE1(leave_notify, event->event);
+
+    // The pointer is still in the window (grab, or moved to a subwindow)
+    if (event->mode != XCB_NOTIFY_MODE_NORMAL || event->detail == XCB_NOTIFY_DETAIL_INFERIOR)
+        return; // Nothing to be done
+
+    if (event->event == pointer_window)
+        pointer_window = XCB_NONE;
+}
+
+/*
+ * Click to focus: raw button presses are reported whoever gets the click, so the application
+ * still receives it and no grab is needed on the clients
+ */
+static void handle_generic_event(xcb_generic_event_t *e)
+{
+    xcb_ge_generic_event_t *event = (xcb_ge_generic_event_t *)e;
+    PROBE2(generic_event, event->extension, event->event_type);
+
+    // The frame a drag waits for
+    if (pace_event(event))
+        return; // Nothing else to be done
+
+    if (xinput_opcode == 0 || event->extension != xinput_opcode ||
+        event->event_type != XCB_INPUT_RAW_BUTTON_PRESS)
+        return; // Nothing to be done
+
+    // Only the left, middle and right buttons, scrolling does not change the focus
+    xcb_input_raw_button_press_event_t *press = (xcb_input_raw_button_press_event_t *)e;
+    if (press->detail < XCB_BUTTON_INDEX_1 || press->detail > XCB_BUTTON_INDEX_3)
+        return; // Nothing to be done
+
+    // Click on the root window or on the focused client
+    if (pointer_window == XCB_NONE || (workspaces[current_workspace] != NULL &&
+                                       workspaces[current_workspace]->id == pointer_window))
+        return; // Nothing to be done
+
+    client *client = client_find(pointer_window);
+    if (client == NULL)
+        return; // Nothing to be done
+
+    focus_unfocus();
+    workspaces[current_workspace] = client;
+    focus_apply();
+}
+
 static void handle_button_release(__attribute__((unused)) xcb_generic_event_t *event)
 {
+    PROBE(button_release);
+
     // We were not moving or resizing the focused client
     if (!moving && !resizing)
         return; // Nothing to be done
 
+    // The last geometry does not wait for the next frame
+    pace_flush();
     xcb_ungrab_pointer(c, XCB_CURRENT_TIME);
     xcb_flush(c);
 
@@ -95,12 +180,17 @@ static void handle_button_release(__attribute__((unused)) xcb_generic_event_t *e
 static void handle_motion_notify(xcb_generic_event_t *e)
 {
     xcb_motion_notify_event_t *event = (xcb_motion_notify_event_t *)e;
+    PROBE2(motion_notify, event->root_x, event->root_y);
     client *client = workspaces[current_workspace];
 
     assert(moving || resizing);
     assert(client != NULL);
     assert(client->id != root);
 
+    // Fullscreen, it does not follow the pointer
+    if (client->fullscreen)
+        return; // Nothing to be done
+
     if (client->maximized)
         client_unmaximize(client);
 
@@ -115,26 +205,31 @@ static void handle_motion_notify(xcb_generic_event_t *e)
         client->y += diff_y;
         client_sanitize_position(client);
 
-        uint32_t values[2] = {client->x, client->y};
-        xcb_configure_window(c, client->id, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, values);
+        // The motions of a frame end up in one configure
+        pace_defer(client, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y);
     }
     else if (resizing)
     {
-        client->width += diff_x;
-        client->height += diff_y;
+        // The size following the pointer is kept aside, moves smaller than an increment add up
+        resize_width += diff_x;
+        resize_height += diff_y;
+        client->width = resize_width > 1 ? resize_width : 1;
+        client->height = resize_height > 1 ? resize_height : 1;
+        client_apply_size_hints(client);
         client_sanitize_dimensions(client);
 
-        uint32_t values[2] = {client->width, client->height};
-        xcb_configure_window(c, client->id, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
-                             values);
+        pace_defer(client, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT);
     }
-
-    xcb_flush(c);
 }
 
 static void handle_destroy_notify(xcb_generic_event_t *e)
 {
     xcb_destroy_notify_event_t *event = (xcb_destroy_notify_event_t *)e;
+    PROBE1(destroy_notify, event->window);
+
+    // A pooled terminal went away
+    if (pool_remove(event->window))
+        return; // Nothing else to be done
 
     client_remove_all_workspaces(event->window);
     if (focused_client != NULL)
@@ -144,6 +239,7 @@ static void handle_destroy_notify(xcb_generic_event_t *e)
 static void handle_unmap_notify(xcb_generic_event_t *e)
 {
     xcb_unmap_notify_event_t *event = (xcb_unmap_notify_event_t *)e;
+    PROBE1(unmap_notify, event->window);
     client *client = client_find_all_workspaces(event->window);
 
     // We don't know this client
@@ -163,20 +259,143 @@ static void handle_unmap_notify(xcb_generic_event_t *e)
 static void handle_map_request(xcb_generic_event_t *e)
 {
     xcb_map_request_event_t *event = (xcb_map_request_event_t *)e;
+    PROBE1(map_request, event->window);
 
+    // client_create() reads the geometry, the requested one must be applied first
+    configure_request_flush();
     client_create(event->window);
 }
 
+// ConfigureRequests of unmanaged windows received during the current batch, merged per window
+#define PENDING_CONFIGURES_SIZE 16
+static xcb_configure_request_event_t pending_configures[PENDING_CONFIGURES_SIZE];
+static uint_fast8_t pending_configures_length = 0;
+
+// Apply the requested change as-is
+static void configure_request_apply(const xcb_configure_request_event_t *event)
+{
+    uint16_t value_mask = 0;
+    uint32_t value_list[7];
+    int8_t i = 0;
+
+    if (event->value_mask & XCB_CONFIG_WINDOW_X)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_X;
+        value_list[i++] = event->x;
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_Y)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_Y;
+        value_list[i++] = event->y;
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_WIDTH)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_WIDTH;
+        value_list[i++] = event->width;
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_HEIGHT)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_HEIGHT;
+        value_list[i++] = event->height;
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
+        value_list[i++] = event->border_width;
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_SIBLING)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_SIBLING;
+        value_list[i++] = event->sibling;
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_STACK_MODE)
+    {
+        value_mask |= XCB_CONFIG_WINDOW_STACK_MODE;
+        value_list[i++] = event->stack_mode;
+    }
+    if (i != 0)
+        xcb_configure_window(c, event->window, value_mask, value_list);
+}
+
+// Merge a request into the pending one of the same window, only the final state gets applied
+static void configure_request_defer(const xcb_configure_request_event_t *event)
+{
+    xcb_configure_request_event_t *pending = NULL;
+
+    for (uint_fast8_t i = 0; i != pending_configures_length; i++)
+    {
+        if (pending_configures[i].window == event->window)
+        {
+            pending = &pending_configures[i];
+            break;
+        }
+    }
+
+    if (pending == NULL)
+    {
+        // Too many windows at once, don't bother merging this one
+        if (pending_configures_length == PENDING_CONFIGURES_SIZE)
+        {
+            configure_request_apply(event);
+            return;
+        }
+
+        pending = &pending_configures[pending_configures_length++];
+        *pending = *event;
+        return;
+    }
+
+    if (event->value_mask & XCB_CONFIG_WINDOW_X)
+        pending->x = event->x;
+    if (event->value_mask & XCB_CONFIG_WINDOW_Y)
+        pending->y = event->y;
+    if (event->value_mask & XCB_CONFIG_WINDOW_WIDTH)
+        pending->width = event->width;
+    if (event->value_mask & XCB_CONFIG_WINDOW_HEIGHT)
+        pending->height = event->height;
+    if (event->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+        pending->border_width = event->border_width;
+    if (event->value_mask & XCB_CONFIG_WINDOW_SIBLING)
+        pending->sibling = event->sibling;
+    if (event->value_mask & XCB_CONFIG_WINDOW_STACK_MODE)
+        pending->stack_mode = event->stack_mode;
+
+    pending->value_mask |= event->value_mask;
+}
+
+// Apply the merged ConfigureRequests of unmanaged windows, called at the end of each event batch
+void configure_request_flush()
+{
+    for (uint_fast8_t i = 0; i != pending_configures_length; i++)
+        configure_request_apply(&pending_configures[i]);
+
+    pending_configures_length = 0;
+}
+
 static void handle_configure_request(xcb_generic_event_t *e)
 {
     xcb_configure_request_event_t *event = (xcb_configure_request_event_t *)e;
+    PROBE2(configure_request, event->window, event->value_mask);
     client *client = client_find_all_workspaces(event->window);
 
+    // Not placed yet, the geometry it asks for goes in the configure sent with its placement
+    if (client == NULL)
+        client = client_find_unplaced(event->window);
+
     if (client != NULL)
     {
-        // The client is maximized
-        if (client->maximized)
-            return; // Nothing to be done
+        // Denied, the client is maximized, fullscreen or the layout decides its geometry: it is
+        // told so with the geometry it keeps
+        if (client->maximized || client->fullscreen || client->tiled)
+        {
+            xcb_send_configure_notify(client);
+            return;
+        }
+
+        int16_t x = client->x;
+        int16_t y = client->y;
+        uint16_t width = client->width;
+        uint16_t height = client->height;
 
         if (event->value_mask & XCB_CONFIG_WINDOW_X)
             client->x = event->x;
@@ -193,66 +412,167 @@ static void handle_configure_request(xcb_generic_event_t *e)
         client_sanitize_position(client);
         client_sanitize_dimensions(client);
 
-        uint32_t values[4] = {client->x, client->y, client->width, client->height};
-        xcb_configure_window(c, client->id,
-                             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
-                                 XCB_CONFIG_WINDOW_HEIGHT,
-                             values);
-        xcb_flush(c);
+        // Only the fields the sanitized request changes
+        uint16_t mask = 0;
+        if (client->x != x)
+            mask |= XCB_CONFIG_WINDOW_X;
+        if (client->y != y)
+            mask |= XCB_CONFIG_WINDOW_Y;
+        if (client->width != width)
+            mask |= XCB_CONFIG_WINDOW_WIDTH;
+        if (client->height != height)
+            mask |= XCB_CONFIG_WINDOW_HEIGHT;
+
+        // Nothing changes and no configure is pending: ICCCM still wants a ConfigureNotify
+        if (mask == 0 && client->dirty == 0)
+            xcb_send_configure_notify(client);
+        else
+        {
+            // The flush answers it, with a ConfigureNotify if it ends up where it already is
+            client_configure_defer(client, mask);
+            client->requested = true;
+        }
     }
 
     // We don't know the client -> apply the requested change
     else
+        configure_request_defer(event);
+}
+
+static void handle_error(xcb_generic_event_t *e)
+{
+    PROBE2(error, ((xcb_generic_error_t *)e)->error_code, e->sequence);
+    xerror_handle((xcb_generic_error_t *)e);
+}
+
+static void handle_expose(xcb_generic_event_t *e)
+{
+    xcb_expose_event_t *event = (xcb_expose_event_t *)e;
+    PROBE1(expose, event->window);
+
+    if (event->window == bar_window)
+        bar_expose(event);
+    else if (event->window == overview_window)
+        overview_expose();
+}
+
+static void handle_property_notify(xcb_generic_event_t *e)
+{
+    xcb_property_notify_event_t *event = (xcb_property_notify_event_t *)e;
+    PROBE2(property_notify, event->window, event->atom);
+    bar_property(event->window, event->atom);
+
+    // Only the properties kbgwm keeps track of are refetched, the titles for the snapshot and
+    // _NET_WM_BYPASS_COMPOSITOR of fullscreen clients
+    bool title = snapshot_active() && (event->atom == XCB_ATOM_WM_NAME ||
+                                       (net_wm_name != XCB_NONE && event->atom == net_wm_name));
+    bool bypass = net_wm_bypass_compositor != XCB_NONE && event->atom == net_wm_bypass_compositor;
+    if (event->atom != XCB_ATOM_WM_NORMAL_HINTS && event->atom != wm_protocols && !title &&
+        !bypass)
+        return; // Nothing else to be done
+
+    client *client = client_find_all_workspaces(event->window);
+    if (client != NULL && (!bypass || client->fullscreen))
+        props_refresh(client, event->atom);
+}
+
+// _NET_WM_STATE changes asked by a client, fullscreen is the only state supported
+static void handle_wm_state(xcb_client_message_event_t *event)
+{
+    if (event->data.data32[1] != net_wm_state_fullscreen &&
+        event->data.data32[2] != net_wm_state_fullscreen)
+        return; // Nothing to be done
+
+    client_request_fullscreen(event->window, event->data.data32[0]);
+}
+
+// Commands sent by kbgwm -s, and requests of clients
+static void handle_client_message(xcb_generic_event_t *e)
+{
+    xcb_client_message_event_t *event = (xcb_client_message_event_t *)e;
+    PROBE2(client_message, event->window, event->type);
+
+    // Answer to a ping, sent back to the root window
+    if (event->type == wm_protocols && event->format == 32 && event->data.data32[0] == net_wm_ping)
     {
-        uint16_t value_mask = 0;
-        uint32_t value_list[7];
-        int8_t i = 0;
+        ping_reply(event->data.data32[2]);
+        return;
+    }
 
-        if (event->value_mask & XCB_CONFIG_WINDOW_X)
-        {
-            value_mask |= XCB_CONFIG_WINDOW_X;
-            value_list[i++] = event->x;
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_Y)
-        {
-            value_mask |= XCB_CONFIG_WINDOW_Y;
-            value_list[i++] = event->y;
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_WIDTH)
-        {
-            value_mask |= XCB_CONFIG_WINDOW_WIDTH;
-            value_list[i++] = event->width;
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_HEIGHT)
-        {
-            value_mask |= XCB_CONFIG_WINDOW_HEIGHT;
-            value_list[i++] = event->height;
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_SIBLING)
-        {
-            value_mask |= XCB_CONFIG_WINDOW_SIBLING;
-            value_list[i++] = event->sibling;
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_STACK_MODE)
-        {
-            value_mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            value_list[i++] = event->stack_mode;
-        }
-        if (i != 0)
-        {
-            xcb_configure_window(c, event->window, value_mask, value_list);
-            xcb_flush(c);
-        }
+    if (event->type == net_wm_state && event->format == 32 && net_wm_state != XCB_NONE)
+    {
+        handle_wm_state(event);
+        return;
     }
+
+    if (event->type != kbgwm_command || event->format != 8)
+        return; // Nothing to be done
+
+    char command[sizeof(event->data.data8) + 1] = {0};
+    memcpy(command, event->data.data8, sizeof(event->data.data8));
+
+    if (strcmp(command, "reload") == 0)
+        rc_reload();
+    else
+        printf("Received unknown command %s\n", command);
 }
 
 void handle_event(xcb_generic_event_t *event)
 {
-    void (*event_handler)(xcb_generic_event_t *) = event_handlers[event->response_type & ~0x80];
+    uint8_t type = event->response_type & ~0x80;
+    PROBE2(event__begin, type, event->sequence);
+
+    // Extension events have no fixed type
+    if (damage_event != 0 && type == damage_event)
+    {
+        overview_damage(event);
+        PROBE1(event__end, type);
+        return;
+    }
+
+    void (*event_handler)(xcb_generic_event_t *) =
+        type < EVENT_HANDLERS_SIZE ? event_handlers[type] : NULL;
     if (event_handler == NULL)
         printf("Received unhandled event, response type %d\n", event->response_type & ~0x80);
     else
+    {
+        audit_event_begin(event->response_type & ~0x80);
         event_handler(event);
+        audit_event_end();
+    }
+
+    PROBE1(event__end, type);
+}
+
+// Receive the raw button presses of every device, for click to focus
+static void setup_xinput()
+{
+    xcb_input_xi_query_version_reply_t *version = NULL;
+
+    // A request to a missing extension would close the connection
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(c, &xcb_input_id);
+    if (extension != NULL && extension->present)
+        version = AUDIT_REPLY(
+            xcb_input_xi_query_version_reply(c, xcb_input_xi_query_version(c, 2, 2), NULL));
+
+    if (version == NULL || version->major_version < 2 ||
+        (version->major_version == 2 && version->minor_version < 2))
+    {
+        printf("setup_xinput: XInput 2.2 is not available, click to focus is disabled\n");
+        free(version);
+        return;
+    }
+
+    free(version);
+    xinput_opcode = extension->major_opcode;
+
+    struct
+    {
+        xcb_input_event_mask_t header;
+        uint32_t mask;
+    } mask = {{XCB_INPUT_DEVICE_ALL_MASTER, 1}, XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS};
+
+    xcb_input_xi_select_events(c, root, 1, &mask.header);
 }
 
 void setup_events()
@@ -272,18 +592,30 @@ void setup_events()
     event_handlers[XCB_UNMAP_NOTIFY] = handle_unmap_notify;
     event_handlers[XCB_MAP_REQUEST] = handle_map_request;
     event_handlers[XCB_CONFIGURE_REQUEST] = handle_configure_request;
+    event_handlers[XCB_CLIENT_MESSAGE] = handle_client_message;
+    event_handlers[XCB_ENTER_NOTIFY] = handle_enter_notify;
+    event_handlers[XCB_LEAVE_NOTIFY] = handle_leave_notify;
+    event_handlers[XCB_GE_GENERIC] = handle_generic_event;
+    event_handlers[0] = handle_error; // X errors come as events with a response type of 0
+    event_handlers[XCB_EXPOSE] = handle_expose;
+    event_handlers[XCB_PROPERTY_NOTIFY] = handle_property_notify;
 
     /*
      * Register X11 events
      */
 
     uint32_t values[] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_STRUCTURE_NOTIFY |
-                         XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY};
+                         XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE};
+
+    // Fails with BadAccess when another window manager is running
+    XERROR_TRACK(xcb_change_window_attributes(c, root, XCB_CW_EVENT_MASK, values));
+
+    chord_compile();
 
-    xcb_change_window_attributes_checked(c, root, XCB_CW_EVENT_MASK, values);
+    for (uint_fast8_t i = 0; i != buttons_length; i++)
+        xcb_register_button_events(buttons[i]);
 
-    for (uint_fast8_t i = 0; i != keys_length; i++)
-        xcb_register_key_events(keys[i]);
+    setup_xinput();
 
     xcb_flush(c);
 }
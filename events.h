@@ -22,3 +22,4 @@
 
 void handle_event(xcb_generic_event_t *);
 void setup_events();
+void configure_request_flush();
@@ -16,16 +16,39 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "kbgwm.h"
+#include "audit.h"
+#include "bar.h"
+#include "chord.h"
 #include "events.h"
+#include "layout.h"
+#include "overview.h"
+#include "pace.h"
+#include "ping.h"
+#include "places.h"
+#include "probes.h"
+#include "pool.h"
+#include "props.h"
+#include "rc.h"
+#include "record.h"
+#include "rules.h"
+#include "snapshot.h"
 #include "xcbutils.h"
+#include "xerror.h"
 #include <X11/keysym.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_icccm.h>
@@ -40,12 +63,31 @@ xcb_window_t root;
 xcb_screen_t *screen;
 uint_least16_t previous_x;
 uint_least16_t previous_y;
+int32_t resize_width; // Size asked for by the pointer during mouseresize, before the size hints
+int32_t resize_height;
+xcb_timestamp_t event_time;
 uint16_t numlockmask = 0;
 xcb_atom_t wm_protocols;
 xcb_atom_t wm_delete_window;
+xcb_atom_t wm_window_role;
+xcb_atom_t kbgwm_command;
+
+xcb_atom_t net_supported;
+xcb_atom_t net_client_list_stacking;
+xcb_atom_t net_wm_name;
+xcb_atom_t net_wm_state;
+xcb_atom_t net_wm_state_fullscreen;
+xcb_atom_t net_wm_bypass_compositor;
+
+// Written to by event_wake() to interrupt event_wait()
+static int wake_pipe[2];
 
 uint_fast8_t current_workspace = 0;
-client *workspaces[NB_WORKSPACES];
+client *workspaces[WORKSPACES_MAX];
+client *stacks[WORKSPACES_MAX]; // Top-most client of each workspace
+client *tiles[WORKSPACES_MAX];  // First client in the tiling order of each workspace
+uint_least8_t layouts[WORKSPACES_MAX];
+uint64_t workspaces_occupied = 0;
 
 static inline void debug_print_globals()
 {
@@ -159,6 +201,11 @@ static void debug_print_event(xcb_generic_event_t *event)
 void mousemove(__attribute__((unused)) const Arg *arg)
 {
     printf("=======[ user action: mousemove ]=======\n");
+
+    // Fullscreen, it is not moved
+    if (focused_client != NULL && focused_client->fullscreen)
+        return; // Nothing to be done
+
     moving = true;
 
     xcb_grab_pointer(
@@ -170,44 +217,244 @@ void mousemove(__attribute__((unused)) const Arg *arg)
 void mouseresize(__attribute__((unused)) const Arg *arg)
 {
     printf("=======[ user action: mouseresize ]=======\n");
+
+    // Fullscreen, it is not resized
+    if (focused_client != NULL && focused_client->fullscreen)
+        return; // Nothing to be done
+
     resizing = true;
 
+    if (focused_client != NULL)
+    {
+        resize_width = focused_client->width;
+        resize_height = focused_client->height;
+    }
+
     xcb_grab_pointer(
         c, 0, screen->root, XCB_EVENT_MASK_BUTTON_MOTION | XCB_EVENT_MASK_BUTTON_RELEASE,
         XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC, screen->root, XCB_NONE, XCB_CURRENT_TIME);
     xcb_flush(c);
 }
 
+// Keyboard move/resize, the step grows while the same key is repeated
+static void nudge(bool resize, uint_least8_t direction)
+{
+    static bool previous_resize;
+    static uint_least8_t previous_direction;
+    static xcb_timestamp_t previous_time;
+    static int16_t step;
+
+    client *client = focused_client;
+
+    // No client are focused, or it is fullscreen
+    if (client == NULL || client->fullscreen)
+        return; // Nothing to be done
+
+    if (resize == previous_resize && direction == previous_direction &&
+        event_time - previous_time < NUDGE_REPEAT_DELAY)
+        step = step + NUDGE_STEP > NUDGE_STEP_MAX ? NUDGE_STEP_MAX : step + NUDGE_STEP;
+    else
+        step = NUDGE_STEP;
+
+    previous_resize = resize;
+    previous_direction = direction;
+    previous_time = event_time;
+
+    if (client->maximized)
+        client_unmaximize(client);
+
+    int16_t diff_x = direction == DIRECTION_LEFT ? -step : direction == DIRECTION_RIGHT ? step : 0;
+    int16_t diff_y = direction == DIRECTION_UP ? -step : direction == DIRECTION_DOWN ? step : 0;
+
+    if (resize)
+    {
+        int32_t width = client->width + diff_x;
+        int32_t height = client->height + diff_y;
+        client->width = width < 1 ? 1 : width;
+        client->height = height < 1 ? 1 : height;
+        client_sanitize_dimensions(client);
+        client_configure_defer(client, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT);
+    }
+    else
+    {
+        client->x += diff_x;
+        client->y += diff_y;
+        client_sanitize_position(client);
+        client_configure_defer(client, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y);
+    }
+}
+
+void keymove(const Arg *arg)
+{
+    printf("=======[ user action: keymove ]=======\n");
+    nudge(false, arg->i);
+}
+
+void keyresize(const Arg *arg)
+{
+    printf("=======[ user action: keyresize ]=======\n");
+    nudge(true, arg->i);
+}
+
+// Send everything the handlers of an event batch have deferred
+static void event_batch_done()
+{
+    props_poll();
+    configure_request_flush();
+    layout_flush();
+    client_configure_flush();
+    client_stacking_publish();
+    overview_bypass();
+    overview_refresh();
+    workspace_trim();
+    bar_update();
+    places_sync();
+    snapshot_publish();
+    xcb_flush(c);
+}
+
+// Make event_wait() return, safe to call from a signal handler
+void event_wake()
+{
+    int saved_errno = errno;
+    if (write(wake_pipe[1], "", 1) == -1)
+    {
+        // The pipe is full, event_wait() will return anyway
+    }
+    errno = saved_errno;
+}
+
+// Wait until the X server or a signal handler has something for us
+static void event_wait()
+{
+    // The pacing timer is -1, ignored by poll(), unless a drag is in progress without Present
+    struct pollfd fds[] = {{.fd = xcb_get_file_descriptor(c), .events = POLLIN},
+                           {.fd = wake_pipe[0], .events = POLLIN},
+                           {.fd = pace_fd(), .events = POLLIN}};
+
+    // Woken up by the nearest ping, kill or chord deadline too
+    int timeout = ping_poll_timeout();
+    int chord = chord_poll_timeout();
+    if (timeout == -1 || (chord != -1 && chord < timeout))
+        timeout = chord;
+
+    if (poll(fds, LENGTH(fds), timeout) == -1 && errno != EINTR)
+        perror("poll");
+
+    if (fds[1].revents & POLLIN)
+    {
+        char buffer[64];
+        while (read(wake_pipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+    }
+}
+
 void eventLoop()
 {
     while (running)
     {
-        xcb_generic_event_t *event = xcb_wait_for_event(c);
-        debug_print_event(event);
+        xcb_generic_event_t *event = xcb_poll_for_event(c);
 
-        handle_event(event);
+        if (event == NULL)
+        {
+            // The connection to the X server was lost
+            if (xcb_connection_has_error(c))
+                break;
+
+            // Work requested by signal handlers, properties fetched by the worker, timers
+            rc_poll();
+            pool_poll();
+            audit_poll();
+            ping_expire();
+            chord_expire();
+            pace_expire();
+            event_batch_done();
+
+            // Waiting for a reply above reads the events that came meanwhile into the queue of
+            // xcb, poll() would not see them on the socket
+            event = xcb_poll_for_queued_event(c);
+            if (event == NULL)
+            {
+                event_wait();
+                continue;
+            }
+        }
+
+        // Handle everything already queued before sending anything, so a burst of events only
+        // costs one flush
+        do
+        {
+            record_event(event);
+            debug_print_event(event);
+
+            handle_event(event);
 
-        free(event);
-        printf("=======[ event: DONE ]=======\n\n");
+            free(event);
+            printf("=======[ event: DONE ]=======\n\n");
+        } while (running && (event = xcb_poll_for_queued_event(c)) != NULL);
+
+        record_batch_end();
+        event_batch_done();
     }
 }
 
-void start(const Arg *arg)
+// Feed a recorded event log to the handlers, the time spent in them is reported at the end
+void replayLoop(bool paced)
 {
-    printf("=======[ user action: start ]=======\n");
-    printf("cmd %s\n", arg->cmd[0]);
+    struct timespec start, end;
+    uint_fast64_t events = 0;
+    uint_fast64_t elapsed = 0;
+    xcb_generic_event_t *event;
+    replay_result result;
 
-    if (fork() == 0)
+    while (running && (result = replay_next(&event, paced)) != REPLAY_EOF)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        if (result == REPLAY_BATCH_END)
+            event_batch_done();
+        else
+        {
+            handle_event(event);
+            free(event);
+            events++;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed += (end.tv_sec - start.tv_sec) * 1000000000 + end.tv_nsec - start.tv_nsec;
+    }
+
+    printf("replay: %" PRIuFAST64 " events in %" PRIuFAST64 " ns (%" PRIuFAST64 " ns/event)\n",
+           events, elapsed, events == 0 ? 0 : elapsed / events);
+}
+
+// Start a command in its own session, returns its pid, -1 if it could not be forked
+pid_t spawn(const char **cmd)
+{
+    pid_t pid = fork();
+    if (pid == 0)
     {
         // Child process
         setsid();
 
-        if (execvp((char *)arg->cmd[0], (char **)arg->cmd) == -1)
+        if (execvp((char *)cmd[0], (char **)cmd) == -1)
         {
-            perror(arg->cmd[0]);
+            perror(cmd[0]);
             exit(-1);
         }
     }
+    else if (pid == -1)
+        perror("fork");
+
+    PROBE2(start, cmd[0], pid);
+    return pid;
+}
+
+void start(const Arg *arg)
+{
+    printf("=======[ user action: start ]=======\n");
+    printf("cmd %s\n", arg->cmd[0]);
+    spawn(arg->cmd);
 }
 
 /*
@@ -218,18 +465,23 @@ void focus_apply()
 {
     assert(workspaces[current_workspace] != NULL);
 
-    // We change the color of the focused client
-    xcb_change_window_attributes(c, workspaces[current_workspace]->id, XCB_CW_BORDER_PIXEL,
-                                 (uint32_t[]){0xFF000000 | FOCUS_COLOR});
+    client *client = workspaces[current_workspace];
+    PROBE2(focus_apply, client->id, current_workspace);
+
+    // We change the color of the focused client, unless it is hung
+    XERROR_TRACK(xcb_change_window_attributes(
+        c, client->id, XCB_CW_BORDER_PIXEL,
+        (uint32_t[]){0xFF000000 | (client->hung ? hung_color : focus_color)}));
 
     // Raise the window so it is on top
-    xcb_configure_window(c, workspaces[current_workspace]->id, XCB_CONFIG_WINDOW_STACK_MODE,
-                         (uint32_t[]){XCB_STACK_MODE_ABOVE});
+    client_raise(client, current_workspace);
 
     // Set the keyboard on the focused window
-    xcb_set_input_focus(c, XCB_INPUT_FOCUS_POINTER_ROOT, workspaces[current_workspace]->id,
-                        XCB_CURRENT_TIME);
-    client_grab_buttons(workspaces[current_workspace], true);
+    XERROR_TRACK(xcb_set_input_focus(c, XCB_INPUT_FOCUS_POINTER_ROOT, client->id,
+                                     XCB_CURRENT_TIME));
+
+    // The user is about to use it, find out whether it still answers
+    ping_client(client);
     xcb_flush(c);
 
     printf("focus_apply: done\n");
@@ -258,16 +510,20 @@ void focus_next(const Arg *arg)
 // Remove the focus from the current client
 void focus_unfocus()
 {
-    client *client = workspaces[current_workspace];
+    focus_unfocus_client(workspaces[current_workspace]);
+}
 
+// Give a client the border of an unfocused client
+void focus_unfocus_client(client *client)
+{
     // No client are focused
     if (client == NULL)
         return; // Nothing to be done
 
-    // Change the border color to UNFOCUS_COLOR
-    xcb_change_window_attributes(c, client->id, XCB_CW_BORDER_PIXEL,
-                                 (uint32_t[]){0xFF000000 | UNFOCUS_COLOR});
-    client_grab_buttons(workspaces[current_workspace], false);
+    // Change the border color to the unfocused one, unless it is hung
+    XERROR_TRACK(xcb_change_window_attributes(
+        c, client->id, XCB_CW_BORDER_PIXEL,
+        (uint32_t[]){0xFF000000 | (client->hung ? hung_color : unfocus_color)}));
 }
 
 /*
@@ -287,8 +543,8 @@ void quit(__attribute__((unused)) const Arg *arg)
 // Retrieve the numlock keycode
 void setup_keyboard()
 {
-    xcb_get_modifier_mapping_reply_t *reply =
-        xcb_get_modifier_mapping_reply(c, xcb_get_modifier_mapping_unchecked(c), NULL);
+    xcb_get_modifier_mapping_reply_t *reply = AUDIT_REPLY(
+        xcb_get_modifier_mapping_reply(c, xcb_get_modifier_mapping_unchecked(c), NULL));
     if (!reply)
     {
         printf("Unable to retrieve midifier mapping");
@@ -325,7 +581,8 @@ void setup_keyboard()
 void setup_screen()
 {
     // Retrieve the children of the root window
-    xcb_query_tree_reply_t *reply = xcb_query_tree_reply(c, xcb_query_tree(c, screen->root), 0);
+    xcb_query_tree_reply_t *reply =
+        AUDIT_REPLY(xcb_query_tree_reply(c, xcb_query_tree(c, screen->root), 0));
     if (NULL == reply)
     {
         printf("Unable to retrieve the root window's children");
@@ -337,11 +594,36 @@ void setup_screen()
 
     // Create the corresponding clients
     for (int i = 0; i != len; i++)
+    {
+        // Our own bar and overview
+        if (children[i] == bar_window || children[i] == overview_window)
+            continue;
+
+        // Record them as map requests, so a replay starts with the same clients
+        xcb_generic_event_t event = {.response_type = XCB_MAP_REQUEST};
+        ((xcb_map_request_event_t *)&event)->parent = screen->root;
+        ((xcb_map_request_event_t *)&event)->window = children[i];
+        record_event(&event);
+
         client_create(children[i]);
+    }
 
     free(reply);
 }
 
+// Advertise the EWMH hints kbgwm maintains
+void setup_ewmh()
+{
+    xcb_atom_t supported[] = {net_client_list_stacking, net_wm_state, net_wm_state_fullscreen,
+                              net_wm_ping};
+
+    // _NET_WM_PING is left out when no client ever interned it
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, root, net_supported, XCB_ATOM_ATOM, 32,
+                        LENGTH(supported) - (net_wm_ping == XCB_NONE), supported);
+    client_stacking_publish();
+    xcb_flush(c);
+}
+
 /*
  * Workspaces
  */
@@ -351,6 +633,9 @@ void workspace_change(const Arg *arg)
     printf("=======[ user action: focus_next ]=======\n");
     printf("i=%d\n", arg->i);
 
+    if (arg->i >= workspaces_max)
+        return; // Nothing to be done
+
     workspace_set(arg->i);
 }
 
@@ -367,6 +652,86 @@ void workspace_previous(__attribute__((unused)) const Arg *arg)
     workspace_set(current_workspace == 0 ? workspaces_length - 1 : current_workspace - 1);
 }
 
+// Go to the next workspace holding clients, after the last one comes the first one
+void workspace_next_occupied(__attribute__((unused)) const Arg *arg)
+{
+    printf("=======[ user action: workspace_next_occupied ]=======\n");
+
+    uint64_t after = workspaces_occupied & (~UINT64_C(0) << current_workspace << 1);
+    uint64_t occupied = after != 0 ? after : workspaces_occupied;
+
+    if (occupied == 0)
+        return; // Nothing to be done
+
+    workspace_set(__builtin_ctzll(occupied));
+}
+
+// Go to the previous workspace holding clients, before the first one comes the last one
+void workspace_previous_occupied(__attribute__((unused)) const Arg *arg)
+{
+    printf("=======[ user action: workspace_previous_occupied ]=======\n");
+
+    uint64_t before = workspaces_occupied & ~(~UINT64_C(0) << current_workspace);
+    uint64_t occupied = before != 0 ? before : workspaces_occupied;
+
+    if (occupied == 0)
+        return; // Nothing to be done
+
+    workspace_set(63 - __builtin_clzll(occupied));
+}
+
+// First workspace without clients, workspaces_max if they all have some
+static uint_fast8_t workspace_first_free()
+{
+    uint64_t empty = ~workspaces_occupied;
+    if (empty == 0)
+        return workspaces_max;
+
+    uint_fast8_t workspace = __builtin_ctzll(empty);
+    return workspace < workspaces_max ? workspace : workspaces_max;
+}
+
+// Go to the first empty workspace
+void workspace_free(__attribute__((unused)) const Arg *arg)
+{
+    printf("=======[ user action: workspace_free ]=======\n");
+
+    uint_fast8_t workspace = workspace_first_free();
+    if (workspace == workspaces_max)
+        return; // Nothing to be done
+
+    workspace_set(workspace);
+}
+
+// Send the focused client to the first empty workspace
+void workspace_send_free(__attribute__((unused)) const Arg *arg)
+{
+    printf("=======[ user action: workspace_send_free ]=======\n");
+
+    uint_fast8_t workspace = workspace_first_free();
+    if (workspace == workspaces_max)
+        return; // Nothing to be done
+
+    workspace_send(&(const Arg){.i = workspace});
+}
+
+// Let go of the empty workspaces above the ones that always exist, the current one and the last
+// one holding clients
+void workspace_trim()
+{
+    uint_fast8_t length = workspaces_occupied != 0 ? 64 - __builtin_clzll(workspaces_occupied) : 0;
+    if (length <= current_workspace)
+        length = current_workspace + 1;
+    if (length < workspaces_min)
+        length = workspaces_min;
+
+    // They come back floating
+    for (uint_fast8_t workspace = length; workspace < workspaces_length; workspace++)
+        layouts[workspace] = LAYOUT_FLOATING;
+
+    workspaces_length = length;
+}
+
 void workspace_send(const Arg *arg)
 {
     printf("=======[ user action: workspace_send ]=======\n");
@@ -375,13 +740,16 @@ void workspace_send(const Arg *arg)
 
     uint_fast8_t new_workspace = arg->i;
 
-    if (current_workspace == new_workspace || workspaces[current_workspace] == NULL)
+    if (current_workspace == new_workspace || new_workspace >= workspaces_max ||
+        workspaces[current_workspace] == NULL)
         return; // Nothing to be done
 
+    // Created on demand, client_add_workspace() extends workspaces_length
+
     client *client = client_remove();
     client_add_workspace(client, new_workspace);
 
-    xcb_unmap_window(c, client->id);
+    XERROR_TRACK(xcb_unmap_window(c, client->id));
     xcb_flush(c);
     printf("workspace_send: done\n");
 }
@@ -389,29 +757,40 @@ void workspace_send(const Arg *arg)
 void workspace_set(uint_fast8_t new_workspace)
 {
     printf("workspace_set: old=%d new=%d\n", current_workspace, new_workspace);
+    PROBE2(workspace_set, current_workspace, new_workspace);
 
     if (current_workspace == new_workspace)
         return; // Nothing to be done
 
+    // Their windows have no content once unmapped, keep their last changes in the overview
+    overview_refresh();
+
     // Unmap the clients of the current workspace (if any)
     client *client = workspaces[current_workspace];
     if (client != NULL)
         do
         {
-            xcb_unmap_window(c, client->id);
+            XERROR_TRACK(xcb_unmap_window(c, client->id));
         } while ((client = client->next) != workspaces[current_workspace]);
 
+    // Restore the stacking order before the clients show up
+    client_restack_workspace(new_workspace);
+
     // Map the clients of the new workspace (if any)
     client = workspaces[new_workspace];
     if (client != NULL)
         do
         {
-            xcb_map_window(c, client->id);
+            XERROR_TRACK(xcb_map_window(c, client->id));
         } while ((client = client->next) != workspaces[new_workspace]);
 
     xcb_flush(c);
     current_workspace = new_workspace;
 
+    // Created on demand, workspace_trim() drops it once left empty
+    if (current_workspace >= workspaces_length)
+        workspaces_length = current_workspace + 1;
+
     if (workspaces[current_workspace] != NULL)
         focus_apply();
 
@@ -422,8 +801,61 @@ void workspace_set(uint_fast8_t new_workspace)
  * Main
  */
 
-int main(void)
+// Send a command to the running instance of kbgwm
+static void send_command(const char *command)
 {
+    xcb_client_message_event_t ev = {.response_type = XCB_CLIENT_MESSAGE,
+                                      .format = 8,
+                                      .window = root,
+                                      .type = xcb_get_atom(KBGWM_COMMAND)};
+    strncpy((char *)ev.data.data8, command, sizeof(ev.data.data8));
+
+    xcb_send_event(c, false, root,
+                   XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY,
+                   (char *)&ev);
+    xcb_flush(c);
+}
+
+static void usage()
+{
+    printf("usage: kbgwm [-c config] [-r log | -p log | -P log] [-s command]\n"
+           "  -c config   read the configuration from config\n"
+           "  -s command  send command (reload) to the running kbgwm\n"
+           "  -r log  record the events received to log\n"
+           "  -p log  replay the events of log at full speed\n"
+           "  -P log  replay the events of log at their original pace\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *config_path = NULL;
+    const char *command = NULL;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    bool paced = false;
+
+    for (int i = 1; i != argc; i++)
+    {
+        if (i + 1 == argc)
+            usage();
+        else if (strcmp(argv[i], "-c") == 0)
+            config_path = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0)
+            command = argv[++i];
+        else if (strcmp(argv[i], "-r") == 0)
+            record_path = argv[++i];
+        else if (strcmp(argv[i], "-p") == 0)
+            replay_path = argv[++i];
+        else if (strcmp(argv[i], "-P") == 0)
+        {
+            replay_path = argv[++i];
+            paced = true;
+        }
+        else
+            usage();
+    }
+
     /*
      * displayname = NULL -> use DISPLAY environment variable
      */
@@ -457,34 +889,99 @@ int main(void)
 
     root = screen->root;
 
+    if (command != NULL)
+    {
+        send_command(command);
+        xcb_disconnect(c);
+        return 0;
+    }
+
     xcb_flush(c);
 
     /*
      * Initialize variables
      */
 
-    for (uint_fast8_t i = 0; i != workspaces_length; i++)
+    for (uint_fast8_t i = 0; i != workspaces_max; i++)
+    {
         workspaces[i] = NULL;
+        stacks[i] = NULL;
+        tiles[i] = NULL;
+        layouts[i] = LAYOUT_FLOATING;
+    }
+
+    if (pipe(wake_pipe) == -1 || fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK) == -1 ||
+        fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK) == -1)
+    {
+        perror("pipe");
+        exit(1);
+    }
 
     wm_protocols = xcb_get_atom(WM_PROTOCOLS);
     wm_delete_window = xcb_get_atom(WM_DELETE_WINDOW);
+    wm_window_role = xcb_get_atom(WM_WINDOW_ROLE);
+    net_supported = xcb_get_atom(NET_SUPPORTED);
+    net_wm_name = xcb_get_atom(NET_WM_NAME);
+    net_wm_state = xcb_get_atom(NET_WM_STATE);
+    net_wm_state_fullscreen = xcb_get_atom(NET_WM_STATE_FULLSCREEN);
+    net_wm_bypass_compositor = xcb_get_atom(NET_WM_BYPASS_COMPOSITOR);
+    net_client_list_stacking = xcb_get_atom(NET_CLIENT_LIST_STACKING);
+    kbgwm_command = xcb_get_atom(KBGWM_COMMAND);
+
+    if (record_path != NULL && !record_open(record_path))
+        exit(1);
+    if (replay_path != NULL && !replay_open(replay_path))
+        exit(1);
 
+    audit_setup();
+    setup_rc(config_path);
+    setup_rules();
     setup_keyboard();
-    setup_screen();
+    setup_overview();
+    setup_ping();
+    setup_pace();
+    // Replayed windows are not remembered, nor published over the snapshot of the running kbgwm
+    if (replay_path == NULL)
+    {
+        setup_places();
+        setup_snapshot();
+    }
+    setup_props();
+    setup_bar();
+    // When replaying, the log starts with the clients existing at record time
+    if (replay_path == NULL)
+        setup_screen();
     setup_events();
+    setup_ewmh();
+    if (replay_path == NULL)
+        setup_pool();
 
     // Event loop
-    eventLoop();
+    if (replay_path == NULL)
+        eventLoop();
+    else
+        replayLoop(paced);
+
+    record_close();
+    replay_close();
+    props_close();
+    pool_close();
+    pace_close();
+    xerror_summary();
 
     for (uint_fast8_t i = 0; i != workspaces_length; i++)
     {
         while (workspaces[i] != NULL)
         {
             client *client = client_remove_workspace(i);
+            places_save(client, i);
             free(client);
         }
     }
 
+    places_close();
+    snapshot_close();
+
     xcb_disconnect(c);
 
     return (0);
@@ -21,20 +21,31 @@
 #include "client.h"
 #include "types.h"
 #include <stdbool.h>
+#include <sys/types.h>
 
+pid_t spawn(const char **cmd);
 void start(const Arg *arg);
 void mousemove(const Arg *arg);
 void mouseresize(const Arg *arg);
+void keymove(const Arg *arg);
+void keyresize(const Arg *arg);
 
 void focus_apply();
 void focus_next(const Arg *);
 void focus_unfocus();
+void focus_unfocus_client(client *);
 void quit(const Arg *);
 void workspace_change(const Arg *);
 void workspace_next(const Arg *);
 void workspace_previous(const Arg *);
 void workspace_send(const Arg *);
+void workspace_next_occupied(const Arg *);
+void workspace_previous_occupied(const Arg *);
+void workspace_free(const Arg *);
+void workspace_send_free(const Arg *);
 void workspace_set(uint_fast8_t);
+void workspace_trim();
+void event_wake();
 
 #define focused_client workspaces[current_workspace]
 
@@ -46,17 +57,70 @@ extern xcb_window_t root;
 extern xcb_screen_t *screen;
 extern uint_least16_t previous_x;
 extern uint_least16_t previous_y;
+extern int32_t resize_width;
+extern int32_t resize_height;
+extern xcb_timestamp_t event_time;
 extern uint16_t numlockmask;
 extern xcb_atom_t wm_protocols;
 extern xcb_atom_t wm_delete_window;
+extern xcb_atom_t wm_window_role;
+extern xcb_atom_t kbgwm_command;
 extern uint_fast8_t current_workspace;
 extern client *workspaces[];
+extern client *stacks[];
+extern uint64_t workspaces_occupied; // One bit per workspace holding clients
+extern client *tiles[];
+extern uint_least8_t layouts[];
+extern xcb_atom_t net_supported;
+extern xcb_atom_t net_client_list_stacking;
+extern xcb_atom_t net_wm_name;
+extern xcb_atom_t net_wm_state;
+extern xcb_atom_t net_wm_state_fullscreen;
+extern xcb_atom_t net_wm_bypass_compositor;
 
-extern const Key keys[];
-extern const Button buttons[];
+extern const Key default_keys[];
+extern const Chord default_chords[];
+extern const Button default_buttons[];
 
-extern const uint_least8_t keys_length;
-extern const uint_least8_t buttons_length;
-extern const uint_least8_t workspaces_length;
-extern const uint_least8_t border_width;
-extern const uint_least8_t border_width_x2;
+extern const uint_least8_t default_keys_length;
+extern const uint_least8_t default_chords_length;
+extern const uint_least8_t default_buttons_length;
+extern const uint_least8_t pool_size;
+extern const char *pool_instance;
+extern const uint_least8_t workspaces_max;
+extern const uint_least8_t default_workspaces_min;
+extern const uint32_t default_focus_color;
+extern const uint32_t default_unfocus_color;
+extern const uint32_t default_hung_color;
+extern const uint32_t ping_interval;
+extern const uint32_t ping_timeout;
+extern const uint32_t default_kill_timeout;
+extern const uint_least8_t default_border_width;
+extern const bool bar_enabled;
+extern const char *bar_font;
+extern const uint32_t bar_foreground;
+extern const uint32_t bar_background;
+extern const bool overview_enabled;
+extern const uint_least8_t master_size;
+extern const bool places_enabled;
+extern const bool snapshot_enabled;
+extern const uint32_t chord_timeout; // Milliseconds, 0 for none
+extern const uint_least16_t pace_rate; // Hz, without Present
+
+// Runtime configuration, config.h values unless the configuration file changes them
+extern const Key *keys;
+extern const Rule *rules; // default_rules, the benchmarks have their own
+extern uint_least8_t rules_length;
+extern const Chord *chords;
+extern const Button *buttons;
+extern uint_least8_t keys_length;
+extern uint_least8_t chords_length;
+extern uint_least8_t buttons_length;
+extern uint32_t focus_color;
+extern uint32_t unfocus_color;
+extern uint32_t hung_color;
+extern uint32_t kill_timeout; // Milliseconds
+extern uint_least8_t workspaces_min;    // Workspaces that exist even when empty
+extern uint_least8_t workspaces_length; // Workspaces that exist, the others are created on demand
+extern uint_least8_t border_width;
+extern uint_least8_t border_width_x2;
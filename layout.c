@@ -0,0 +1,200 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "layout.h"
+#include "bar.h"
+#include "kbgwm.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <xcb/xcb.h>
+
+// Workspaces to arrange at the end of the event batch, one bit each
+static uint64_t dirty_workspaces = 0;
+
+void layout_dirty(uint_fast8_t workspace)
+{
+    assert(workspace < 64);
+
+    if (layouts[workspace] != LAYOUT_FLOATING)
+        dirty_workspaces |= UINT64_C(1) << workspace;
+}
+
+// Give a tiled client its floating geometry back
+static void layout_float(client *client)
+{
+    if (!client->tiled)
+        return; // Nothing to be done
+
+    client->tiled = false;
+    client->x = client->float_x;
+    client->y = client->float_y;
+    client->width = client->float_width;
+    client->height = client->float_height;
+
+    // client_unmaximize() or client_unfullscreen() will restore it
+    if (!client->maximized && !client->fullscreen)
+        client_configure_defer(client, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+                                           XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT);
+}
+
+void layout_add(client *client, uint_fast8_t workspace)
+{
+    client->tile_next = tiles[workspace];
+    tiles[workspace] = client;
+
+    if (layouts[workspace] == LAYOUT_FLOATING)
+        layout_float(client);
+    else
+        layout_dirty(workspace);
+}
+
+void layout_remove(client *client, uint_fast8_t workspace)
+{
+    for (struct client_t **p = &tiles[workspace]; *p != NULL; p = &(*p)->tile_next)
+    {
+        if (*p == client)
+        {
+            *p = client->tile_next;
+            break;
+        }
+    }
+
+    layout_dirty(workspace);
+}
+
+// Outer geometry of the i-th of n tiles, in an area of width x height
+static xcb_rectangle_t layout_tile(uint_fast8_t layout, uint32_t i, uint32_t n, uint32_t width,
+                                   uint32_t height)
+{
+    uint32_t x0, x1, y0, y1;
+
+    if (layout == LAYOUT_MASTER)
+    {
+        uint32_t master_width = n == 1 ? width : width * master_size / 100;
+
+        if (i == 0)
+            return (xcb_rectangle_t){0, 0, master_width, height};
+
+        // The others share the rest of the screen, one row each
+        x0 = master_width;
+        x1 = width;
+        y0 = (i - 1) * height / (n - 1);
+        y1 = i * height / (n - 1);
+    }
+    else
+    {
+        // As many columns as rows, or one more
+        uint32_t columns = 1;
+        while (columns * columns < n)
+            columns++;
+        uint32_t rows = (n + columns - 1) / columns;
+
+        x0 = i % columns * width / columns;
+        x1 = (i % columns + 1) * width / columns;
+        y0 = i / columns * height / rows;
+        y1 = (i / columns + 1) * height / rows;
+    }
+
+    return (xcb_rectangle_t){x0, y0, x1 - x0, y1 - y0};
+}
+
+// Move a client to its tile, only the fields that changed are configured
+static void layout_place(client *client, xcb_rectangle_t tile)
+{
+    if (!client->tiled)
+    {
+        client->tiled = true;
+        client->float_x = client->x;
+        client->float_y = client->y;
+        client->float_width = client->width;
+        client->float_height = client->height;
+    }
+
+    int16_t y = tile.y + bar_height;
+    uint16_t width = tile.width > border_width_x2 ? tile.width - border_width_x2 : 1;
+    uint16_t height = tile.height > border_width_x2 ? tile.height - border_width_x2 : 1;
+    uint16_t mask = 0;
+
+    if (client->x != tile.x)
+        mask |= XCB_CONFIG_WINDOW_X;
+    if (client->y != y)
+        mask |= XCB_CONFIG_WINDOW_Y;
+    if (client->width != width)
+        mask |= XCB_CONFIG_WINDOW_WIDTH;
+    if (client->height != height)
+        mask |= XCB_CONFIG_WINDOW_HEIGHT;
+
+    if (mask == 0)
+        return; // Nothing to be done
+
+    client->x = tile.x;
+    client->y = y;
+    client->width = width;
+    client->height = height;
+    client_configure_defer(client, mask);
+}
+
+static void layout_arrange(uint_fast8_t workspace)
+{
+    // Maximized and fullscreen clients stay out of the tiles
+    uint32_t n = 0;
+    for (client *client = tiles[workspace]; client != NULL; client = client->tile_next)
+        n += !client->maximized && !client->fullscreen;
+
+    // The list is newest first, the tiles oldest first: a new client gets the last tile
+    uint32_t i = n;
+    for (client *client = tiles[workspace]; client != NULL; client = client->tile_next)
+    {
+        if (client->maximized || client->fullscreen)
+            continue;
+
+        layout_place(client, layout_tile(layouts[workspace], --i, n, screen->width_in_pixels,
+                                         screen->height_in_pixels - bar_height));
+    }
+}
+
+// Arrange the workspaces that changed, called at the end of each event batch
+void layout_flush()
+{
+    while (dirty_workspaces != 0)
+    {
+        uint_fast8_t workspace = __builtin_ctzll(dirty_workspaces);
+        dirty_workspaces &= dirty_workspaces - 1;
+
+        if (workspace < workspaces_length && layouts[workspace] != LAYOUT_FLOATING)
+            layout_arrange(workspace);
+    }
+}
+
+// Change the layout of the current workspace
+void layout(const Arg *arg)
+{
+    printf("=======[ user action: layout ]=======\n");
+
+    if (layouts[current_workspace] == arg->i)
+        return; // Nothing to be done
+
+    layouts[current_workspace] = arg->i;
+
+    if (arg->i == LAYOUT_FLOATING)
+        for (client *client = tiles[current_workspace]; client != NULL; client = client->tile_next)
+            layout_float(client);
+    else
+        layout_dirty(current_workspace);
+}
@@ -0,0 +1,35 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "client.h"
+#include "types.h"
+
+/*
+ * Tiling layouts, chosen per workspace. The oldest client gets the first tile and a new one the
+ * last, so in a grid it usually leaves the others where they are. A change only marks the
+ * workspace, layout_flush() arranges it once at the end of the event batch and only the clients
+ * whose tile moved get a configure.
+ */
+
+void layout(const Arg *);
+void layout_add(client *, uint_fast8_t);
+void layout_remove(client *, uint_fast8_t);
+void layout_dirty(uint_fast8_t);
+void layout_flush();
@@ -0,0 +1,331 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "overview.h"
+#include "audit.h"
+#include "kbgwm.h"
+#include "xcbutils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/composite.h>
+#include <xcb/damage.h>
+#include <xcb/render.h>
+#include <xcb/xcb_renderutil.h>
+
+#define OVERVIEW_GAP 2
+
+uint8_t damage_event = 0;
+xcb_window_t overview_window = XCB_NONE;
+
+static bool shown = false;
+static const xcb_render_query_pict_formats_reply_t *formats;
+static xcb_render_pictformat_t root_format;
+static xcb_render_picture_t overview_picture;
+static uint_fast8_t columns;
+static uint16_t tile_width, tile_height;
+
+// Clients whose window changed since their thumbnail was rendered
+static client *damaged_clients = NULL;
+
+static xcb_render_color_t render_color(uint32_t color)
+{
+    return (xcb_render_color_t){((color >> 16) & 0xFF) * 0x101, ((color >> 8) & 0xFF) * 0x101,
+                                (color & 0xFF) * 0x101, 0xFFFF};
+}
+
+void setup_overview()
+{
+    if (!overview_enabled)
+        return; // Nothing to be done
+
+    // A request to a missing extension would close the connection
+    const xcb_query_extension_reply_t *extensions[] = {xcb_get_extension_data(c, &xcb_composite_id),
+                                                       xcb_get_extension_data(c, &xcb_damage_id),
+                                                       xcb_get_extension_data(c, &xcb_render_id)};
+    bool available = true;
+    for (uint_fast8_t i = 0; i != LENGTH(extensions); i++)
+        available = available && extensions[i] != NULL && extensions[i]->present;
+
+    if (available)
+    {
+        xcb_composite_query_version_cookie_t composite_cookie =
+            xcb_composite_query_version(c, 0, 2);
+        xcb_damage_query_version_cookie_t damage_cookie = xcb_damage_query_version(c, 1, 1);
+
+        xcb_composite_query_version_reply_t *composite =
+            AUDIT_REPLY(xcb_composite_query_version_reply(c, composite_cookie, NULL));
+        xcb_damage_query_version_reply_t *damage =
+            AUDIT_REPLY(xcb_damage_query_version_reply(c, damage_cookie, NULL));
+        available = composite != NULL && damage != NULL &&
+                    (composite->major_version > 0 || composite->minor_version >= 2);
+        free(composite);
+        free(damage);
+    }
+
+    formats = available ? xcb_render_util_query_formats(c) : NULL;
+    xcb_render_pictvisual_t *root_visual =
+        formats == NULL ? NULL : xcb_render_util_find_visual_format(formats, screen->root_visual);
+
+    if (!available || root_visual == NULL)
+    {
+        printf("setup_overview: Composite 0.2, Damage or Render is not available\n");
+        return;
+    }
+
+    root_format = root_visual->format;
+    damage_event = extensions[1]->first_event + XCB_DAMAGE_NOTIFY;
+
+    // The windows keep their content while they are covered
+    xcb_composite_redirect_subwindows(c, root, XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+
+    // As many columns as rows, enough for the workspaces that always exist
+    for (columns = 1; columns * columns < workspaces_min; columns++)
+        ;
+    tile_width = screen->width_in_pixels / columns;
+    tile_height = screen->height_in_pixels / columns;
+
+    overview_window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, overview_window, root, 0, 0,
+                      screen->width_in_pixels, screen->height_in_pixels, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_BACK_PIXMAP | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK,
+                      (uint32_t[]){XCB_BACK_PIXMAP_NONE, 1,
+                                   XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_BUTTON_PRESS});
+
+    overview_picture = xcb_generate_id(c);
+    xcb_render_create_picture(c, overview_picture, overview_window, root_format, 0, NULL);
+}
+
+// Start following the changes of a client's window
+void overview_track(client *client)
+{
+    if (damage_event == 0 || client->damage != XCB_NONE)
+        return; // Nothing to be done
+
+    xcb_render_pictvisual_t *visual =
+        client->visual != 0 ? xcb_render_util_find_visual_format(formats, client->visual) : NULL;
+
+    // Sampled columns times smaller
+    xcb_render_fixed_t scale = columns << 16;
+    client->window_picture = xcb_generate_id(c);
+    xcb_render_create_picture(c, client->window_picture, client->id,
+                              visual != NULL ? visual->format : root_format,
+                              XCB_RENDER_CP_SUBWINDOW_MODE,
+                              (uint32_t[]){XCB_SUBWINDOW_MODE_INCLUDE_INFERIORS});
+    xcb_render_set_picture_transform(
+        c, client->window_picture,
+        (xcb_render_transform_t){scale, 0, 0, 0, scale, 0, 0, 0, 1 << 16});
+    xcb_render_set_picture_filter(c, client->window_picture, 8, "bilinear", 0, NULL);
+
+    client->damage = xcb_generate_id(c);
+    xcb_damage_create(c, client->damage, client->id, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+}
+
+// The window is gone, along with its picture and damage, the thumbnail is ours to free
+void overview_forget(client *client)
+{
+    if (client->damage == XCB_NONE)
+        return; // Nothing to be done
+
+    for (struct client_t **p = &damaged_clients; client->damaged && *p != NULL;
+         p = &(*p)->damaged_next)
+    {
+        if (*p == client)
+        {
+            *p = client->damaged_next;
+            break;
+        }
+    }
+
+    if (client->thumbnail != XCB_NONE)
+    {
+        xcb_render_free_picture(c, client->thumbnail_picture);
+        xcb_free_pixmap(c, client->thumbnail);
+    }
+
+    client->damage = XCB_NONE;
+    client->thumbnail = XCB_NONE;
+    client->damaged = false;
+}
+
+void overview_damage(xcb_generic_event_t *e)
+{
+    xcb_damage_notify_event_t *event = (xcb_damage_notify_event_t *)e;
+    client *client = client_find_all_workspaces(event->drawable);
+
+    if (client == NULL || client->damaged)
+        return; // Nothing to be done
+
+    client->damaged = true;
+    client->damaged_next = damaged_clients;
+    damaged_clients = client;
+}
+
+static void overview_draw()
+{
+    xcb_render_fill_rectangles(
+        c, XCB_RENDER_PICT_OP_SRC, overview_picture, render_color(bar_background), 1,
+        &(xcb_rectangle_t){0, 0, screen->width_in_pixels, screen->height_in_pixels});
+
+    // The workspaces created on demand are shown while there is room left
+    for (uint_fast8_t workspace = 0;
+         workspace != workspaces_length && workspace != columns * columns; workspace++)
+    {
+        int16_t x = workspace % columns * tile_width;
+        int16_t y = workspace / columns * tile_height;
+
+        if (workspace == current_workspace)
+            xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, overview_picture,
+                                       render_color(focus_color), 1,
+                                       &(xcb_rectangle_t){x, y, tile_width, tile_height});
+
+        xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, overview_picture,
+                                   render_color(0), 1,
+                                   &(xcb_rectangle_t){x + OVERVIEW_GAP, y + OVERVIEW_GAP,
+                                                      tile_width - 2 * OVERVIEW_GAP,
+                                                      tile_height - 2 * OVERVIEW_GAP});
+
+        // From the bottom of the stack to the top
+        client *client = stacks[workspace];
+        while (client != NULL && client->stack_below != NULL)
+            client = client->stack_below;
+
+        for (; client != NULL; client = client->stack_above)
+        {
+            if (client->thumbnail == XCB_NONE)
+                continue;
+
+            xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, client->thumbnail_picture, XCB_NONE,
+                                 overview_picture, 0, 0, 0, 0, x + client->x / columns,
+                                 y + client->y / columns, client->thumbnail_width,
+                                 client->thumbnail_height);
+        }
+    }
+}
+
+// Render the thumbnails of the damaged clients, while their windows are still mapped
+void overview_refresh()
+{
+    if (damaged_clients == NULL)
+        return; // Nothing to be done
+
+    while (damaged_clients != NULL)
+    {
+        client *client = damaged_clients;
+        damaged_clients = client->damaged_next;
+        client->damaged = false;
+
+        uint16_t width = client->width / columns, height = client->height / columns;
+        if (width == 0 || height == 0)
+            continue;
+
+        // The window was resized
+        if (client->thumbnail != XCB_NONE &&
+            (client->thumbnail_width != width || client->thumbnail_height != height))
+        {
+            xcb_render_free_picture(c, client->thumbnail_picture);
+            xcb_free_pixmap(c, client->thumbnail);
+            client->thumbnail = XCB_NONE;
+        }
+
+        if (client->thumbnail == XCB_NONE)
+        {
+            client->thumbnail = xcb_generate_id(c);
+            client->thumbnail_width = width;
+            client->thumbnail_height = height;
+            xcb_create_pixmap(c, screen->root_depth, client->thumbnail, root, width, height);
+
+            client->thumbnail_picture = xcb_generate_id(c);
+            xcb_render_create_picture(c, client->thumbnail_picture, client->thumbnail,
+                                      root_format, 0, NULL);
+        }
+
+        xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, client->window_picture, XCB_NONE,
+                             client->thumbnail_picture, 0, 0, 0, 0, 0, 0, width, height);
+
+        // Report the next change
+        xcb_damage_subtract(c, client->damage, XCB_NONE, XCB_NONE);
+    }
+
+    if (shown)
+        overview_draw();
+}
+
+// While the focused client is fullscreen, its window is shown by the X server instead of being
+// copied from its redirection: the windows are only redirected again once it is not anymore, or
+// for the overview to be drawn
+void overview_bypass()
+{
+    static bool bypassed = false;
+
+    const client *client = focused_client;
+    bool bypass = damage_event != 0 && !shown && client != NULL && client->fullscreen &&
+                  client->bypass_compositor != BYPASS_COMPOSITOR_OFF;
+
+    if (bypass == bypassed)
+        return; // Nothing to be done
+
+    if (bypass)
+        xcb_composite_unredirect_subwindows(c, root, XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+    else
+        xcb_composite_redirect_subwindows(c, root, XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+
+    bypassed = bypass;
+}
+
+void overview_expose()
+{
+    if (shown)
+        overview_draw();
+}
+
+// Show or hide the overview
+void overview(__attribute__((unused)) const Arg *arg)
+{
+    printf("=======[ user action: overview ]=======\n");
+
+    if (overview_window == XCB_NONE)
+        return; // Nothing to be done
+
+    shown = !shown;
+
+    // Drawn on Expose
+    if (shown)
+    {
+        xcb_map_window(c, overview_window);
+        xcb_configure_window(c, overview_window, XCB_CONFIG_WINDOW_STACK_MODE,
+                             (uint32_t[]){XCB_STACK_MODE_ABOVE});
+    }
+    else
+        xcb_unmap_window(c, overview_window);
+
+    xcb_flush(c);
+}
+
+// A click on a workspace switches to it
+void overview_click(xcb_button_press_event_t *event)
+{
+    uint_fast8_t workspace =
+        event->event_y / tile_height * columns + event->event_x / tile_width;
+
+    overview(NULL);
+
+    if (workspace < workspaces_length)
+        workspace_set(workspace);
+}
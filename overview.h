@@ -0,0 +1,43 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "client.h"
+#include "types.h"
+#include <xcb/xcb.h>
+
+/*
+ * Workspace overview: every workspace at once, drawn from thumbnails kept per client. Windows are
+ * redirected with Composite, a thumbnail is rendered (scaled by Render) only when Damage reports
+ * a change to its window, so showing the overview draws what is already there and maps nothing
+ * but the overview window itself.
+ */
+
+extern uint8_t damage_event; // Response type of DamageNotify, 0 when the overview is unavailable
+extern xcb_window_t overview_window;
+
+void setup_overview();
+void overview(const Arg *);
+void overview_track(client *);
+void overview_forget(client *);
+void overview_damage(xcb_generic_event_t *);
+void overview_refresh();
+void overview_bypass();
+void overview_expose();
+void overview_click(xcb_button_press_event_t *);
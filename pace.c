@@ -0,0 +1,189 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pace.h"
+#include "audit.h"
+#include "kbgwm.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <xcb/present.h>
+
+// Major opcode of Present, 0 when the timer paces the drags
+static uint8_t present_opcode = 0;
+static uint32_t serial = 0; // Of the last NotifyMSC, the frames requested before are ignored
+
+static int timer = -1; // Without Present, -1 when there is no pacing at all
+
+static client *pending = NULL; // Waiting for the next frame
+static uint16_t pending_mask = 0;
+static bool waiting = false; // A frame is requested, or the timer is ticking
+
+void setup_pace()
+{
+    xcb_present_query_version_reply_t *version = NULL;
+
+    // A request to a missing extension would close the connection
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(c, &xcb_present_id);
+    if (extension != NULL && extension->present)
+        version = AUDIT_REPLY(
+            xcb_present_query_version_reply(c, xcb_present_query_version(c, 1, 0), NULL));
+
+    if (version != NULL)
+    {
+        free(version);
+        present_opcode = extension->major_opcode;
+        xcb_present_select_input(c, xcb_generate_id(c), root,
+                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+        return;
+    }
+
+    printf("setup_pace: Present is not available, drags are paced at %d Hz\n", pace_rate);
+
+    if (pace_rate == 0)
+        return; // Nothing to be done
+
+    if ((timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1)
+        perror("setup_pace");
+}
+
+// Ask for the next frame, the timer keeps ticking until a frame finds nothing to do
+static void pace_request()
+{
+    waiting = true;
+
+    if (present_opcode != 0)
+    {
+        // The next vblank of the CRTC showing the root window
+        xcb_present_notify_msc(c, root, ++serial, 0, 1, 0);
+        return;
+    }
+
+    uint64_t period = UINT64_C(1000000000) / pace_rate;
+    struct timespec interval = {.tv_sec = period / 1000000000, .tv_nsec = period % 1000000000};
+    struct itimerspec spec = {.it_interval = interval, .it_value = interval};
+    if (timerfd_settime(timer, 0, &spec, NULL) == -1)
+    {
+        perror("pace_request");
+        waiting = false;
+    }
+}
+
+static void pace_frame()
+{
+    if (pending == NULL)
+    {
+        // Nothing moved since the previous frame
+        waiting = false;
+        if (timer != -1)
+            timerfd_settime(timer, 0, &(struct itimerspec){0}, NULL);
+        return;
+    }
+
+    client_configure_defer(pending, pending_mask);
+    pending = NULL;
+    pending_mask = 0;
+
+    // Present answers once, the timer ticks on
+    if (present_opcode != 0)
+        waiting = false;
+}
+
+// The geometry of a client being dragged changed, it is configured at the next frame
+void pace_defer(client *client, uint16_t mask)
+{
+    // No pacing, configured at the end of the batch
+    if (present_opcode == 0 && timer == -1)
+    {
+        client_configure_defer(client, mask);
+        return;
+    }
+
+    if (pending != NULL && pending != client)
+        client_configure_defer(pending, pending_mask);
+
+    if (pending != client)
+        pending_mask = 0;
+
+    pending = client;
+    pending_mask |= mask;
+
+    if (!waiting)
+        pace_request();
+}
+
+// A Present event, returns false for the events of other extensions
+bool pace_event(xcb_ge_generic_event_t *event)
+{
+    if (present_opcode == 0 || event->extension != present_opcode)
+        return false;
+
+    xcb_present_complete_notify_event_t *complete = (xcb_present_complete_notify_event_t *)event;
+    if (event->event_type == XCB_PRESENT_COMPLETE_NOTIFY &&
+        complete->kind == XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC && complete->serial == serial)
+        pace_frame();
+
+    return true;
+}
+
+// The timer to poll() while it ticks, -1 otherwise
+int pace_fd()
+{
+    return waiting ? timer : -1;
+}
+
+void pace_expire()
+{
+    uint64_t ticks;
+    if (timer == -1 || read(timer, &ticks, sizeof(ticks)) != sizeof(ticks))
+        return; // Nothing to be done
+
+    pace_frame();
+}
+
+// The drag is over, its last geometry goes out with the batch
+void pace_flush()
+{
+    if (pending == NULL)
+        return; // Nothing to be done
+
+    client_configure_defer(pending, pending_mask);
+    pending = NULL;
+    pending_mask = 0;
+}
+
+// The client is going away
+void pace_forget(client *client)
+{
+    if (pending != client)
+        return; // Nothing to be done
+
+    pending = NULL;
+    pending_mask = 0;
+}
+
+void pace_close()
+{
+    if (timer != -1)
+        close(timer);
+}
@@ -0,0 +1,38 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "client.h"
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+/*
+ * Drag pacing: the geometry a mouse move or resize leaves pending is configured once per displayed
+ * frame, at the vblank reported by the Present extension (NotifyMSC), or on a timer ticking
+ * PACE_RATE times a second when Present is not available.
+ */
+
+void setup_pace();
+void pace_defer(client *, uint16_t);
+bool pace_event(xcb_ge_generic_event_t *);
+int pace_fd();
+void pace_expire();
+void pace_flush();
+void pace_forget(client *);
+void pace_close();
@@ -0,0 +1,327 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "ping.h"
+#include "kbgwm.h"
+#include "xcbutils.h"
+#include "xerror.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcbext.h>
+
+#define PING_HOST_NAME_SIZE 256
+
+xcb_atom_t net_wm_ping = XCB_NONE;
+xcb_atom_t net_wm_pid = XCB_NONE;
+
+static xcb_atom_t wm_client_machine;
+static char host_name[PING_HOST_NAME_SIZE];
+
+// Clients with a deadline, a ping waiting for its answer or a kill waiting for its timeout
+static client *timed_clients = NULL;
+
+static uint64_t ping_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void ping_arm(client *client)
+{
+    if (client->timed)
+        return; // Nothing to be done
+
+    client->timed = true;
+    client->timed_next = timed_clients;
+    timed_clients = client;
+}
+
+static void ping_disarm(client *client)
+{
+    for (struct client_t **p = &timed_clients; client->timed && *p != NULL; p = &(*p)->timed_next)
+    {
+        if (*p == client)
+        {
+            *p = client->timed_next;
+            break;
+        }
+    }
+
+    client->timed = false;
+}
+
+// Give a client the border it would have if it was not hung, or the hung one
+static void ping_border(client *client)
+{
+    uint32_t color = unfocus_color;
+
+    if (client->hung)
+        color = hung_color;
+    else
+    {
+        for (uint64_t occupied = workspaces_occupied; occupied != 0; occupied &= occupied - 1)
+            if (workspaces[__builtin_ctzll(occupied)] == client)
+                color = focus_color;
+    }
+
+    XERROR_TRACK(xcb_change_window_attributes(c, client->id, XCB_CW_BORDER_PIXEL,
+                                              (uint32_t[]){0xFF000000 | color}));
+}
+
+// Stop waiting for the replies ping_kill() asked for
+static void ping_discard(client *client)
+{
+    if (client->pid_sequence != 0)
+        xcb_discard_reply(c, client->pid_sequence);
+    if (client->machine_sequence != 0)
+        xcb_discard_reply(c, client->machine_sequence);
+
+    client->pid_sequence = 0;
+    client->machine_sequence = 0;
+}
+
+// The value of a property ping_kill() asked for, NULL if it is not there (yet)
+static xcb_get_property_reply_t *ping_property(unsigned int *sequence)
+{
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+
+    if (*sequence == 0 || !xcb_poll_for_reply(c, *sequence, &reply, &error))
+        return NULL;
+
+    *sequence = 0;
+    free(error);
+    return reply;
+}
+
+// Kill a client for good: SIGKILL when its process runs on this machine, and close its connection
+static void ping_terminate(client *client)
+{
+    pid_t pid = 0;
+    bool local = false;
+
+    xcb_get_property_reply_t *reply = ping_property(&client->pid_sequence);
+    if (reply != NULL)
+    {
+        if (reply->format == 32 && xcb_get_property_value_length(reply) == 4)
+            pid = *(uint32_t *)xcb_get_property_value(reply);
+        free(reply);
+    }
+
+    reply = ping_property(&client->machine_sequence);
+    if (reply != NULL)
+    {
+        size_t length = xcb_get_property_value_length(reply);
+        local = length == strlen(host_name) &&
+                memcmp(xcb_get_property_value(reply), host_name, length) == 0;
+        free(reply);
+    }
+
+    ping_discard(client);
+
+    if (local && pid > 1 && pid != getpid())
+    {
+        printf("ping_terminate: sending SIGKILL to %d\n", pid);
+        if (kill(pid, SIGKILL) == -1)
+            perror("ping_terminate");
+    }
+
+    // The pid may be wrong or unknown, closing the connection at least removes its windows
+    printf("ping_terminate: killing client %u\n", client->id);
+    XERROR_TRACK(xcb_kill_client(c, client->id));
+}
+
+void setup_ping()
+{
+    net_wm_ping = xcb_get_atom(NET_WM_PING);
+    net_wm_pid = xcb_get_atom(NET_WM_PID);
+    wm_client_machine = xcb_get_atom(WM_CLIENT_MACHINE);
+
+    if (gethostname(host_name, sizeof(host_name)) == -1)
+    {
+        perror("setup_ping");
+        host_name[0] = '\0';
+    }
+
+    host_name[sizeof(host_name) - 1] = '\0';
+}
+
+// Ping a client, unless it does not support it, was pinged recently or still has to answer
+void ping_client(client *client)
+{
+    if (!client->ping || client->ping_deadline != 0)
+        return; // Nothing to be done
+
+    uint64_t now = ping_now();
+    if (client->pinged != 0 && now - client->pinged < ping_interval)
+        return; // Nothing to be done
+
+    xcb_client_message_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.response_type = XCB_CLIENT_MESSAGE;
+    ev.format = 32;
+    ev.window = client->id;
+    ev.type = wm_protocols;
+    ev.data.data32[0] = net_wm_ping;
+    ev.data.data32[1] = event_time;
+    ev.data.data32[2] = client->id;
+    XERROR_TRACK(xcb_send_event(c, false, client->id, XCB_EVENT_MASK_NO_EVENT, (char *)&ev));
+
+    client->pinged = now;
+    client->ping_deadline = now + ping_timeout;
+    ping_arm(client);
+}
+
+// A client answered a ping, even late: it is not hung
+void ping_reply(xcb_window_t window)
+{
+    client *client = client_find_all_workspaces(window);
+    if (client == NULL || (client->ping_deadline == 0 && !client->hung))
+        return; // Nothing to be done
+
+    printf("ping_reply: %u answered after %" PRIu64 " ms\n", window, ping_now() - client->pinged);
+    client->ping_deadline = 0;
+
+    if (client->hung)
+    {
+        client->hung = false;
+        ping_border(client);
+    }
+
+    if (client->kill_deadline == 0)
+        ping_disarm(client);
+}
+
+// The client was asked to close: kill it if it is still there and not answering pings kill_timeout
+// milliseconds later, or now when it was asked already
+void ping_kill(client *client)
+{
+    if (client->kill_deadline != 0)
+    {
+        client->kill_deadline = 0;
+        if (client->ping_deadline == 0)
+            ping_disarm(client);
+        ping_terminate(client);
+        return;
+    }
+
+    // Only polled for, they are there long before the timeout
+    if (net_wm_pid != XCB_NONE)
+        client->pid_sequence = xcb_get_property_unchecked(c, 0, client->id, net_wm_pid,
+                                                          XCB_ATOM_CARDINAL, 0, 1)
+                                   .sequence;
+    if (wm_client_machine != XCB_NONE)
+        client->machine_sequence =
+            xcb_get_property_unchecked(c, 0, client->id, wm_client_machine, XCB_ATOM_STRING, 0,
+                                       PING_HOST_NAME_SIZE / 4)
+                .sequence;
+
+    client->kill_deadline = ping_now() + kill_timeout;
+    ping_arm(client);
+
+    // Whether it still answers is what decides, ask now unless a ping is waiting for its answer
+    if (client->ping_deadline == 0)
+    {
+        client->pinged = 0;
+        ping_client(client);
+    }
+}
+
+// The client is going away
+void ping_forget(client *client)
+{
+    ping_discard(client);
+    ping_disarm(client);
+    client->ping_deadline = 0;
+    client->kill_deadline = 0;
+}
+
+// Milliseconds until the nearest deadline, -1 when there is none, for poll()
+int ping_poll_timeout()
+{
+    if (timed_clients == NULL)
+        return -1;
+
+    uint64_t next = UINT64_MAX;
+    for (client *client = timed_clients; client != NULL; client = client->timed_next)
+    {
+        if (client->ping_deadline != 0 && client->ping_deadline < next)
+            next = client->ping_deadline;
+        if (client->kill_deadline != 0 && client->kill_deadline < next)
+            next = client->kill_deadline;
+    }
+
+    uint64_t now = ping_now();
+    if (next <= now)
+        return 0;
+
+    return next - now > INT_MAX ? INT_MAX : (int)(next - now);
+}
+
+// Act on the deadlines that passed, called by the event loop when it is idle
+void ping_expire()
+{
+    uint64_t now = ping_now();
+
+    for (struct client_t **p = &timed_clients; *p != NULL;)
+    {
+        client *client = *p;
+
+        if (client->ping_deadline != 0 && client->ping_deadline <= now)
+        {
+            printf("ping_expire: %u does not answer\n", client->id);
+            client->ping_deadline = 0;
+            client->hung = true;
+            ping_border(client);
+        }
+
+        if (client->kill_deadline != 0 && client->kill_deadline <= now)
+        {
+            client->kill_deadline = 0;
+
+            // Still answering: it is probably asking the user something, like saving a file
+            if (client->hung || client->ping_deadline != 0 || !client->ping)
+                ping_terminate(client);
+            else
+            {
+                printf("ping_expire: %u still answers, not killed\n", client->id);
+                ping_discard(client);
+            }
+        }
+
+        if (client->ping_deadline == 0 && client->kill_deadline == 0)
+        {
+            *p = client->timed_next;
+            client->timed = false;
+        }
+        else
+            p = &client->timed_next;
+    }
+}
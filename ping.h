@@ -0,0 +1,41 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "client.h"
+#include <xcb/xcb.h>
+
+/*
+ * Hung clients: the focused client is pinged (_NET_WM_PING), one that does not answer in time gets
+ * the hung border until it does. client_kill() arms a timer, a client still there when it expires
+ * and not answering pings is killed. The deadlines are waited for by the poll() of the event loop,
+ * nothing here waits on a client.
+ */
+
+extern xcb_atom_t net_wm_ping;
+extern xcb_atom_t net_wm_pid;
+
+void setup_ping();
+void ping_client(client *);
+void ping_reply(xcb_window_t);
+void ping_kill(client *);
+void ping_forget(client *);
+int ping_poll_timeout();
+void ping_expire();
@@ -0,0 +1,254 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "places.h"
+#include "kbgwm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PLACES_MAGIC "kbgwmpl1" // Changes with the layout of the file
+
+typedef struct
+{
+    uint32_t hash; // 0 for a free slot
+    char class_name[PLACES_CLASS_SIZE];
+    int16_t x, y;
+    uint16_t width, height;
+    uint8_t workspace;
+    uint8_t saved; // A window of this class went away already, the geometry is set
+    uint8_t padding[2];
+} place;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t slots;
+    uint32_t padding;
+    place places[PLACES_SLOTS];
+} places_file;
+
+static places_file *file = NULL;
+static bool written = false; // Since the last msync()
+
+// FNV-1a, unseeded: the hashes are stored in the file
+static uint32_t places_hash(const char *string)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*string)
+    {
+        hash ^= (uint8_t)*string++;
+        hash *= 16777619u;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+// Create a directory and its parents, like mkdir -p
+static bool places_mkdir(char *path)
+{
+    for (char *p = path + 1; *p != '\0'; p++)
+    {
+        if (*p != '/')
+            continue;
+
+        *p = '\0';
+        bool failed = mkdir(path, 0700) == -1 && errno != EEXIST;
+        *p = '/';
+        if (failed)
+            return false;
+    }
+
+    return mkdir(path, 0700) == 0 || errno == EEXIST;
+}
+
+void setup_places()
+{
+    if (!places_enabled)
+        return; // Nothing to be done
+
+    // $XDG_STATE_HOME/kbgwm/places, or ~/.local/state/kbgwm/places when it is not set
+    const char *directory = getenv("XDG_STATE_HOME");
+    const char *format = "%s/kbgwm";
+    if (directory == NULL && (directory = getenv("HOME")) != NULL)
+        format = "%s/.local/state/kbgwm";
+
+    if (directory == NULL)
+        return; // Nothing to be done
+
+    char path[4096];
+    int length = snprintf(path, sizeof(path) - sizeof("/places"), format, directory);
+    if (length < 0 || (size_t)length >= sizeof(path) - sizeof("/places") || !places_mkdir(path))
+    {
+        printf("setup_places: unable to create the directory of %s\n", path);
+        return;
+    }
+    strcat(path, "/places");
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror(path);
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+
+    // A new file, or one from another version: start from an empty table
+    bool fresh = st.st_size != sizeof(places_file);
+    if (fresh && ftruncate(fd, sizeof(places_file)) == -1)
+    {
+        perror(path);
+        close(fd);
+        return;
+    }
+
+    void *mapping = mmap(NULL, sizeof(places_file), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror(path);
+        return;
+    }
+
+    file = mapping;
+    if (fresh || memcmp(file->magic, PLACES_MAGIC, sizeof(file->magic)) != 0 ||
+        file->slots != PLACES_SLOTS)
+    {
+        memset(file, 0, sizeof(places_file));
+        memcpy(file->magic, PLACES_MAGIC, sizeof(file->magic));
+        file->slots = PLACES_SLOTS;
+        written = true;
+    }
+
+    printf("setup_places: %s\n", path);
+}
+
+// Read by the properties worker too, set before it starts
+bool places_active()
+{
+    return file != NULL;
+}
+
+// Slot of a class, claimed if it has none yet; -1 when the table is full or unavailable
+int16_t places_find(const char *class_name)
+{
+    if (file == NULL)
+        return -1;
+
+    uint32_t hash = places_hash(class_name);
+
+    for (uint32_t i = 0; i != PLACES_SLOTS; i++)
+    {
+        uint32_t slot = (hash + i) & (PLACES_SLOTS - 1);
+        place *place = &file->places[slot];
+
+        if (place->hash == hash &&
+            strncmp(place->class_name, class_name, PLACES_CLASS_SIZE - 1) == 0)
+            return slot;
+
+        if (place->hash == 0)
+        {
+            place->hash = hash;
+            strncpy(place->class_name, class_name, PLACES_CLASS_SIZE - 1);
+            place->class_name[PLACES_CLASS_SIZE - 1] = '\0';
+            written = true;
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
+// The rule of a window merged with where its class was last seen, for what the rule leaves open.
+// False when nothing was saved for the class.
+bool places_recall(int16_t slot, const Rule *rule, Rule *recalled)
+{
+    if (file == NULL || slot < 0 || !file->places[slot].saved)
+        return false;
+
+    const place *place = &file->places[slot];
+    *recalled = rule != NULL ? *rule : (Rule){.workspace = -1, .focus = true};
+
+    if (recalled->width == 0)
+    {
+        recalled->x = place->x;
+        recalled->y = place->y;
+        recalled->width = place->width;
+        recalled->height = place->height;
+    }
+
+    if (recalled->workspace < 0 && place->workspace < workspaces_max)
+        recalled->workspace = place->workspace;
+
+    return true;
+}
+
+// Remember where a window is, it is going away
+void places_save(const client *client, uint_fast8_t workspace)
+{
+    if (file == NULL || client->place < 0)
+        return; // Nothing to be done
+
+    place *place = &file->places[client->place];
+
+    // Tiled windows are remembered where they float
+    place->x = client->tiled ? client->float_x : client->x;
+    place->y = client->tiled ? client->float_y : client->y;
+    place->width = client->tiled ? client->float_width : client->width;
+    place->height = client->tiled ? client->float_height : client->height;
+    place->workspace = workspace;
+    place->saved = true;
+    written = true;
+}
+
+// Schedule the write back of what changed, called at the end of each event batch
+void places_sync()
+{
+    if (!written)
+        return; // Nothing to be done
+
+    if (msync(file, sizeof(places_file), MS_ASYNC) == -1)
+        perror("places_sync");
+    written = false;
+}
+
+void places_close()
+{
+    if (file == NULL)
+        return; // Nothing to be done
+
+    if (written && msync(file, sizeof(places_file), MS_SYNC) == -1)
+        perror("places_close");
+
+    munmap(file, sizeof(places_file));
+    file = NULL;
+    written = false;
+}
@@ -0,0 +1,41 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "client.h"
+#include "types.h"
+#include <stdbool.h>
+
+/*
+ * Where each application was last seen: the geometry and workspace of the last window of each
+ * WM_CLASS, kept in a hash table mapped from $XDG_STATE_HOME/kbgwm/places. A window is recorded
+ * when it goes away, the mapping is synced once per event batch.
+ */
+
+#define PLACES_SLOTS 512 // Power of two
+#define PLACES_CLASS_SIZE 48
+
+void setup_places();
+bool places_active();
+int16_t places_find(const char *);
+bool places_recall(int16_t, const Rule *, Rule *);
+void places_save(const client *, uint_fast8_t);
+void places_sync();
+void places_close();
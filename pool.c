@@ -0,0 +1,183 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pool.h"
+#include "kbgwm.h"
+#include "overview.h"
+#include "xcbutils.h"
+#include "xerror.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+extern const char **pool_cmd;
+
+static client **pool = NULL;
+static uint_fast8_t pool_length = 0;
+static pid_t *pending = NULL; // Started, but not mapped yet, oldest first
+static uint_fast8_t pool_pending = 0;
+
+// Set by SIGCHLD, pool_poll() reaps the children then
+static volatile sig_atomic_t children_exited = 0;
+
+static void handle_sigchld(__attribute__((unused)) int signal)
+{
+    children_exited = 1;
+    event_wake();
+}
+
+// Start terminals until the pool is full, they are adopted when they ask to be mapped
+static void pool_refill()
+{
+    while (pool_length + pool_pending < pool_size)
+    {
+        pid_t pid = spawn(pool_cmd);
+        if (pid == -1)
+            break;
+
+        pending[pool_pending++] = pid;
+    }
+}
+
+// No longer wait for the pending terminal at index i
+static void pool_pending_remove(uint_fast8_t i)
+{
+    for (pool_pending--; i != pool_pending; i++)
+        pending[i] = pending[i + 1];
+}
+
+void setup_pool()
+{
+    if (pool_size == 0)
+        return; // Nothing to be done
+
+    pool = emalloc(pool_size * sizeof(client *));
+    pending = emalloc(pool_size * sizeof(pid_t));
+
+    struct sigaction action = {.sa_handler = handle_sigchld,
+                               .sa_flags = SA_RESTART | SA_NOCLDSTOP};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    pool_refill();
+}
+
+// Reap the exited children, called from the event loop. A pending terminal that exited without
+// mapping its window (missing, failed to start) is not waited for anymore; it is not restarted
+// until the next terminal action, which would only fail again.
+void pool_poll()
+{
+    if (!children_exited)
+        return; // Nothing to be done
+
+    children_exited = 0;
+
+    pid_t pid;
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+    {
+        for (uint_fast8_t i = 0; i != pool_pending; i++)
+        {
+            if (pending[i] == pid)
+            {
+                printf("pool_poll: terminal %d exited before mapping\n", pid);
+                pool_pending_remove(i);
+                break;
+            }
+        }
+    }
+}
+
+// Keep one of our terminals in the pool. Only the ones we are waiting for are adopted, found by
+// their _NET_WM_PID, a handed out terminal found again after a restart stays where it is. Without
+// a pid, the oldest one is taken for it.
+bool pool_adopt(client *client, pid_t pid)
+{
+    uint_fast8_t i = 0;
+    while (i != pool_pending && pid != 0 && pending[i] != pid)
+        i++;
+
+    if (i == pool_pending)
+        return false;
+
+    printf("pool_adopt: id=%d pid=%d\n", client->id, pid);
+
+    pool[pool_length++] = client;
+    pool_pending_remove(i);
+
+    return true;
+}
+
+// Forget a pooled terminal that went away, returns false if the window is not in the pool
+bool pool_remove(xcb_window_t id)
+{
+    for (uint_fast8_t i = 0; i != pool_length; i++)
+    {
+        if (pool[i]->id == id)
+        {
+            free(pool[i]);
+            pool[i] = pool[--pool_length];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Close the pooled terminals, nobody would ever see them otherwise
+void pool_close()
+{
+    while (pool_length != 0)
+    {
+        client *client = pool[--pool_length];
+
+        if (!xcb_send_atom(client, wm_delete_window))
+            xcb_kill_client(c, client->id);
+
+        free(client);
+    }
+
+    xcb_flush(c);
+}
+
+// Show a pooled terminal on the current workspace, or start arg->cmd if the pool is empty
+void terminal(const Arg *arg)
+{
+    printf("=======[ user action: terminal ]=======\n");
+
+    if (pool_length == 0)
+    {
+        start(arg);
+        pool_refill();
+        return;
+    }
+
+    client *client = pool[--pool_length];
+
+    focus_unfocus();
+    client_add_workspace(client, current_workspace);
+    XERROR_TRACK(xcb_map_window(c, client->id));
+    overview_track(client);
+    focus_apply();
+
+    // Replace it in the background
+    pool_refill();
+}
@@ -0,0 +1,36 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "client.h"
+#include "types.h"
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Warm terminal pool: terminals started in advance, kept unmapped and out of every workspace until
+ * the terminal action hands one out.
+ */
+
+void setup_pool();
+void pool_poll();
+bool pool_adopt(client *, pid_t);
+bool pool_remove(xcb_window_t);
+void pool_close();
+void terminal(const Arg *);
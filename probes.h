@@ -0,0 +1,78 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * USDT probes, provider kbgwm, for bpftrace and perf (see README)
+ *
+ * Each probe is a nop in the code and a note in the binary, a tracer attaching to it turns the nop
+ * into a breakpoint: nothing is done while nobody traces. They are compiled in whenever
+ * <sys/sdt.h> (systemtap-sdt-dev) is installed, build with -DNO_PROBES to leave them out.
+ */
+
+#if !defined(NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define PROBES
+#endif
+#endif
+
+#ifdef PROBES
+
+#include <sys/sdt.h>
+
+#define PROBE(name) DTRACE_PROBE(kbgwm, name)
+#define PROBE1(name, a) DTRACE_PROBE1(kbgwm, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(kbgwm, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(kbgwm, name, a, b, c)
+
+// Blocking waits for a reply, with their call site: reply__begin and reply__end
+#define PROBE_REPLY(reply)                                                                         \
+    probe_reply_end(__FILE__, __LINE__, (probe_reply_begin(__FILE__, __LINE__), (reply)))
+#define PROBE_REPLY_VALUE(reply)                                                                   \
+    probe_reply_end_value(__FILE__, __LINE__, (probe_reply_begin(__FILE__, __LINE__), (reply)))
+
+#include <stdint.h>
+
+static inline void probe_reply_begin(const char *file, int line)
+{
+    PROBE2(reply__begin, file, line);
+}
+
+static inline void *probe_reply_end(const char *file, int line, void *reply)
+{
+    PROBE2(reply__end, file, line);
+    return reply;
+}
+
+static inline uint32_t probe_reply_end_value(const char *file, int line, uint32_t reply)
+{
+    PROBE2(reply__end, file, line);
+    return reply;
+}
+
+#else
+
+#define PROBE(name)
+#define PROBE1(name, a)
+#define PROBE2(name, a, b)
+#define PROBE3(name, a, b, c)
+#define PROBE_REPLY(reply) (reply)
+#define PROBE_REPLY_VALUE(reply) (reply)
+
+#endif
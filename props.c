@@ -0,0 +1,622 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "props.h"
+#include "audit.h"
+#include "client.h"
+#include "kbgwm.h"
+#include "overview.h"
+#include "ping.h"
+#include "places.h"
+#include "snapshot.h"
+#include "xcbutils.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcbext.h>
+
+#define PROPS_QUEUE_SIZE 256 // Power of two
+
+/*
+ * Single producer, single consumer rings: tail is only written by the producer, head by the
+ * consumer, each one reads the other's index with acquire semantics
+ */
+
+// Windows to fetch, from the event loop to the worker
+static struct
+{
+    xcb_window_t items[PROPS_QUEUE_SIZE];
+    unsigned int head, tail;
+} requests;
+
+// Fetched properties, from the worker to the event loop
+static struct
+{
+    props items[PROPS_QUEUE_SIZE];
+    unsigned int head, tail;
+} results;
+
+static xcb_connection_t *worker_c = NULL;
+static pthread_t worker;
+static bool worker_running = false;
+static bool worker_stop = false;
+// Written to by props_request() to wake the worker up
+static int worker_pipe[2];
+
+static bool request_push(xcb_window_t window)
+{
+    unsigned int tail = requests.tail;
+
+    if (tail - __atomic_load_n(&requests.head, __ATOMIC_ACQUIRE) == PROPS_QUEUE_SIZE)
+        return false;
+
+    requests.items[tail % PROPS_QUEUE_SIZE] = window;
+    __atomic_store_n(&requests.tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static uint_fast8_t request_pop_batch(xcb_window_t *windows)
+{
+    unsigned int head = requests.head;
+    unsigned int tail = __atomic_load_n(&requests.tail, __ATOMIC_ACQUIRE);
+    uint_fast8_t length = 0;
+
+    for (; head != tail && length != PROPS_BATCH_SIZE; head++)
+        windows[length++] = requests.items[head % PROPS_QUEUE_SIZE];
+
+    __atomic_store_n(&requests.head, head, __ATOMIC_RELEASE);
+    return length;
+}
+
+static bool result_push(const props *props)
+{
+    unsigned int tail = results.tail;
+
+    if (tail - __atomic_load_n(&results.head, __ATOMIC_ACQUIRE) == PROPS_QUEUE_SIZE)
+        return false;
+
+    results.items[tail % PROPS_QUEUE_SIZE] = *props;
+    __atomic_store_n(&results.tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool result_pop(props *props)
+{
+    unsigned int head = results.head;
+
+    if (head == __atomic_load_n(&results.tail, __ATOMIC_ACQUIRE))
+        return false;
+
+    *props = results.items[head % PROPS_QUEUE_SIZE];
+    __atomic_store_n(&results.head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Copy a string that may not be NUL-terminated, truncating it to PROPS_NAME_SIZE
+static void props_copy(char *destination, const char *source, size_t length)
+{
+    if (length > PROPS_NAME_SIZE - 1)
+        length = PROPS_NAME_SIZE - 1;
+
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+}
+
+// Take the title from a WM_NAME or _NET_WM_NAME reply, false when it has none
+static bool props_title(char *title, xcb_get_property_reply_t *reply)
+{
+    int length = reply != NULL ? xcb_get_property_value_length(reply) : 0;
+    if (length <= 0)
+        return false;
+
+    if (length > SNAPSHOT_TITLE_SIZE - 1)
+        length = SNAPSHOT_TITLE_SIZE - 1;
+
+    memcpy(title, xcb_get_property_value(reply), length);
+    title[length] = '\0';
+    return true;
+}
+
+static xcb_get_property_cookie_t props_title_request(xcb_connection_t *conn, xcb_window_t window,
+                                                     xcb_atom_t atom)
+{
+    return xcb_get_property_unchecked(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0,
+                                      SNAPSHOT_TITLE_SIZE / 4);
+}
+
+// Replies waited for by the event loop (no worker, or the worker is late) are audited and traced
+// like the others, those of the worker block nobody
+#define PROPS_REPLY(conn, reply) ((conn) == c ? AUDIT_REPLY(reply) : (reply))
+#define PROPS_REPLY_VALUE(conn, reply) ((conn) == c ? AUDIT_REPLY_VALUE(reply) : (reply))
+
+// Fetch the properties of a batch of windows, all the requests are sent before waiting for the
+// first reply so the whole batch costs one round trip
+static void props_fetch(xcb_connection_t *conn, const xcb_window_t *windows, uint_fast8_t length,
+                        props *out)
+{
+    xcb_get_property_cookie_t hints_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t class_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t role_cookies[PROPS_BATCH_SIZE];
+    xcb_get_window_attributes_cookie_t attributes_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t protocols_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t name_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t net_name_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t state_cookies[PROPS_BATCH_SIZE];
+    xcb_get_property_cookie_t pid_cookies[PROPS_BATCH_SIZE];
+    const bool pids = pool_size != 0 && net_wm_pid != XCB_NONE;
+    const bool metadata = rules_length != 0 || pool_size != 0 || places_active();
+    const bool titles = snapshot_active();
+
+    for (uint_fast8_t i = 0; i != length; i++)
+    {
+        hints_cookies[i] = xcb_icccm_get_wm_normal_hints_unchecked(conn, windows[i]);
+        protocols_cookies[i] =
+            xcb_icccm_get_wm_protocols_unchecked(conn, windows[i], wm_protocols);
+        state_cookies[i] = xcb_get_property_unchecked(conn, 0, windows[i], net_wm_state,
+                                                      XCB_ATOM_ATOM, 0, PROPS_STATE_SIZE);
+
+        if (damage_event != 0)
+            attributes_cookies[i] = xcb_get_window_attributes_unchecked(conn, windows[i]);
+
+        if (pids)
+            pid_cookies[i] = xcb_get_property_unchecked(conn, 0, windows[i], net_wm_pid,
+                                                        XCB_ATOM_CARDINAL, 0, 1);
+
+        if (titles)
+        {
+            name_cookies[i] = props_title_request(conn, windows[i], XCB_ATOM_WM_NAME);
+            net_name_cookies[i] = props_title_request(conn, windows[i], net_wm_name);
+        }
+
+        if (metadata)
+        {
+            class_cookies[i] = xcb_icccm_get_wm_class_unchecked(conn, windows[i]);
+            role_cookies[i] = xcb_get_property_unchecked(conn, 0, windows[i], wm_window_role,
+                                                         XCB_ATOM_STRING, 0, PROPS_NAME_SIZE / 4);
+        }
+    }
+
+    for (uint_fast8_t i = 0; i != length; i++)
+    {
+        props *p = &out[i];
+        p->window = windows[i];
+        p->has_hints =
+            PROPS_REPLY_VALUE(conn, xcb_icccm_get_wm_normal_hints_reply(conn, hints_cookies[i],
+                                                                          &p->hints, NULL));
+        p->has_class = false;
+        p->has_role = false;
+        p->visual = 0;
+        p->ping = false;
+        p->title[0] = '\0';
+        p->title_utf8 = false;
+        p->pid = 0;
+        p->fullscreen = false;
+        p->states_length = 0;
+
+        xcb_icccm_get_wm_protocols_reply_t protocols;
+        if (PROPS_REPLY_VALUE(conn, xcb_icccm_get_wm_protocols_reply(conn, protocols_cookies[i],
+                                                                     &protocols, NULL)))
+        {
+            for (uint32_t j = 0; j != protocols.atoms_len; j++)
+                p->ping |= net_wm_ping != XCB_NONE && protocols.atoms[j] == net_wm_ping;
+            xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+        }
+
+        // Set before mapping the window, as EWMH has it for a client starting fullscreen
+        xcb_get_property_reply_t *state =
+            PROPS_REPLY(conn, xcb_get_property_reply(conn, state_cookies[i], NULL));
+        if (state != NULL && state->format == 32)
+        {
+            const xcb_atom_t *atoms = xcb_get_property_value(state);
+            for (int j = 0; j != xcb_get_property_value_length(state) / 4; j++)
+            {
+                if (atoms[j] == net_wm_state_fullscreen)
+                    p->fullscreen = true;
+                else if (p->states_length != PROPS_STATE_SIZE)
+                    p->states[p->states_length++] = atoms[j];
+            }
+        }
+        free(state);
+
+        if (damage_event != 0)
+        {
+            xcb_get_window_attributes_reply_t *attributes = PROPS_REPLY(
+                conn, xcb_get_window_attributes_reply(conn, attributes_cookies[i], NULL));
+            if (attributes != NULL)
+            {
+                p->visual = attributes->visual;
+                free(attributes);
+            }
+        }
+
+        if (pids)
+        {
+            // Tells which of the terminals started by the pool mapped
+            xcb_get_property_reply_t *pid =
+                PROPS_REPLY(conn, xcb_get_property_reply(conn, pid_cookies[i], NULL));
+            if (pid != NULL && pid->format == 32 && xcb_get_property_value_length(pid) == 4)
+                p->pid = *(uint32_t *)xcb_get_property_value(pid);
+            free(pid);
+        }
+
+        if (titles)
+        {
+            xcb_get_property_reply_t *name =
+                PROPS_REPLY(conn, xcb_get_property_reply(conn, name_cookies[i], NULL));
+            xcb_get_property_reply_t *net_name =
+                PROPS_REPLY(conn, xcb_get_property_reply(conn, net_name_cookies[i], NULL));
+
+            // _NET_WM_NAME first, WM_NAME is for the clients that do not set it
+            p->title_utf8 = props_title(p->title, net_name);
+            if (!p->title_utf8)
+                props_title(p->title, name);
+
+            free(name);
+            free(net_name);
+        }
+
+        if (!metadata)
+            continue;
+
+        xcb_icccm_get_wm_class_reply_t class;
+        if (PROPS_REPLY_VALUE(conn,
+                              xcb_icccm_get_wm_class_reply(conn, class_cookies[i], &class, NULL)))
+        {
+            p->has_class = true;
+            props_copy(p->class_name, class.class_name, strlen(class.class_name));
+            props_copy(p->instance_name, class.instance_name, strlen(class.instance_name));
+            xcb_icccm_get_wm_class_reply_wipe(&class);
+        }
+
+        xcb_get_property_reply_t *role =
+            PROPS_REPLY(conn, xcb_get_property_reply(conn, role_cookies[i], NULL));
+        if (role != NULL)
+        {
+            p->has_role = true;
+            props_copy(p->role, xcb_get_property_value(role),
+                       xcb_get_property_value_length(role));
+            free(role);
+        }
+    }
+}
+
+static void *props_worker(__attribute__((unused)) void *arg)
+{
+    xcb_window_t windows[PROPS_BATCH_SIZE];
+    props batch[PROPS_BATCH_SIZE];
+    char buffer[64];
+
+    while (read(worker_pipe[0], buffer, sizeof(buffer)) > 0 &&
+           !__atomic_load_n(&worker_stop, __ATOMIC_ACQUIRE))
+    {
+        uint_fast8_t length;
+
+        while ((length = request_pop_batch(windows)) != 0)
+        {
+            props_fetch(worker_c, windows, length, batch);
+
+            for (uint_fast8_t i = 0; i != length; i++)
+            {
+                // The event loop is late, give it some time to catch up
+                while (!result_push(&batch[i]))
+                {
+                    event_wake();
+                    nanosleep(&(struct timespec){0, 1000000}, NULL);
+                }
+            }
+
+            event_wake();
+        }
+    }
+
+    return NULL;
+}
+
+void setup_props()
+{
+    worker_c = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(worker_c))
+    {
+        printf("setup_props: no second connection, the properties will be fetched by the event "
+               "loop\n");
+        xcb_disconnect(worker_c);
+        return;
+    }
+
+    if (pipe(worker_pipe) == -1 || fcntl(worker_pipe[1], F_SETFL, O_NONBLOCK) == -1)
+    {
+        perror("setup_props");
+        xcb_disconnect(worker_c);
+        return;
+    }
+
+    // Signals are handled by the event loop
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int error = pthread_create(&worker, NULL, props_worker, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (error != 0)
+    {
+        printf("setup_props: unable to start the worker: %s\n", strerror(error));
+        close(worker_pipe[0]);
+        close(worker_pipe[1]);
+        xcb_disconnect(worker_c);
+        return;
+    }
+
+    worker_running = true;
+}
+
+// Queue the fetch of the properties of a new client, client_properties() gets them later
+void props_request(xcb_window_t window)
+{
+    // No worker: the queue is drained by props_poll(), or now when it is full
+    if (!worker_running)
+    {
+        if (!request_push(window))
+        {
+            props_poll();
+            request_push(window);
+        }
+
+        return;
+    }
+
+    // The worker is late, fetch them now
+    if (!request_push(window))
+    {
+        props props;
+        props_fetch(c, &window, 1, &props);
+        client_properties(&props);
+        return;
+    }
+
+    if (write(worker_pipe[1], "", 1) == -1)
+    {
+        // The pipe is full, the worker has been woken up already
+    }
+}
+
+// Clients with a refetch on its way
+static client *refreshing_clients = NULL;
+
+// Refetch a property of a client that changed, props_poll() takes the reply once it is there
+void props_refresh(client *client, xcb_atom_t atom)
+{
+    unsigned int *sequence;
+    xcb_get_property_cookie_t cookie;
+
+    if (atom == XCB_ATOM_WM_NORMAL_HINTS)
+    {
+        sequence = &client->hints_sequence;
+        cookie = xcb_icccm_get_wm_normal_hints_unchecked(c, client->id);
+    }
+    else if (atom == wm_protocols)
+    {
+        sequence = &client->protocols_sequence;
+        cookie = xcb_icccm_get_wm_protocols_unchecked(c, client->id, wm_protocols);
+    }
+    else if (snapshot_active() && atom == XCB_ATOM_WM_NAME)
+    {
+        sequence = &client->name_sequence;
+        cookie = props_title_request(c, client->id, atom);
+    }
+    else if (snapshot_active() && atom == net_wm_name && atom != XCB_NONE)
+    {
+        sequence = &client->net_name_sequence;
+        cookie = props_title_request(c, client->id, atom);
+    }
+    else if (atom == net_wm_bypass_compositor && atom != XCB_NONE)
+    {
+        sequence = &client->bypass_sequence;
+        cookie = xcb_get_property_unchecked(c, 0, client->id, atom, XCB_ATOM_CARDINAL, 0, 1);
+    }
+    else
+        return; // Nothing to be done
+
+    // Changed again before the previous reply came, only the newest one matters
+    if (*sequence != 0)
+        xcb_discard_reply(c, *sequence);
+    *sequence = cookie.sequence;
+
+    if (!client->refreshing)
+    {
+        client->refreshing = true;
+        client->refreshing_next = refreshing_clients;
+        refreshing_clients = client;
+    }
+}
+
+// The client is going away, its refetches are not waited for
+void props_forget(client *client)
+{
+    if (!client->refreshing)
+        return; // Nothing to be done
+
+    for (struct client_t **p = &refreshing_clients; *p != NULL; p = &(*p)->refreshing_next)
+    {
+        if (*p == client)
+        {
+            *p = client->refreshing_next;
+            break;
+        }
+    }
+
+    if (client->hints_sequence != 0)
+        xcb_discard_reply(c, client->hints_sequence);
+    if (client->protocols_sequence != 0)
+        xcb_discard_reply(c, client->protocols_sequence);
+    if (client->name_sequence != 0)
+        xcb_discard_reply(c, client->name_sequence);
+    if (client->net_name_sequence != 0)
+        xcb_discard_reply(c, client->net_name_sequence);
+    if (client->bypass_sequence != 0)
+        xcb_discard_reply(c, client->bypass_sequence);
+
+    client->hints_sequence = 0;
+    client->protocols_sequence = 0;
+    client->name_sequence = 0;
+    client->net_name_sequence = 0;
+    client->bypass_sequence = 0;
+    client->refreshing = false;
+}
+
+// Take the reply of a refetch if it has arrived, NULL while it is on its way or when it failed
+static xcb_get_property_reply_t *props_refresh_reply(unsigned int *sequence, bool *arrived)
+{
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+
+    *arrived = *sequence != 0 && xcb_poll_for_reply(c, *sequence, &reply, &error);
+    if (!*arrived)
+        return NULL;
+
+    *sequence = 0;
+    free(error);
+    return reply;
+}
+
+// Apply the refetched properties that arrived
+static void props_poll_refreshed()
+{
+    for (struct client_t **p = &refreshing_clients; *p != NULL;)
+    {
+        client *client = *p;
+        bool arrived;
+
+        xcb_get_property_reply_t *reply = props_refresh_reply(&client->hints_sequence, &arrived);
+        if (arrived)
+        {
+            xcb_size_hints_t hints;
+            bool has_hints =
+                reply != NULL && xcb_icccm_get_wm_size_hints_from_reply(&hints, reply);
+            printf("props_poll: %d has new size hints\n", client->id);
+            client_size_hints(client, has_hints ? &hints : NULL);
+            free(reply);
+        }
+
+        reply = props_refresh_reply(&client->protocols_sequence, &arrived);
+        if (arrived)
+        {
+            xcb_icccm_get_wm_protocols_reply_t protocols;
+            client->ping = false;
+
+            // The reply belongs to protocols from then on
+            if (reply != NULL && xcb_icccm_get_wm_protocols_from_reply(reply, &protocols))
+            {
+                for (uint32_t i = 0; i != protocols.atoms_len; i++)
+                    client->ping |= net_wm_ping != XCB_NONE && protocols.atoms[i] == net_wm_ping;
+                xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+            }
+            else
+                free(reply);
+        }
+
+        reply = props_refresh_reply(&client->net_name_sequence, &arrived);
+        if (arrived)
+        {
+            // Without _NET_WM_NAME, the title is the one of WM_NAME, refetched
+            client->title_utf8 = props_title(client->title, reply);
+            if (!client->title_utf8)
+                props_refresh(client, XCB_ATOM_WM_NAME);
+            free(reply);
+        }
+
+        reply = props_refresh_reply(&client->name_sequence, &arrived);
+        if (arrived)
+        {
+            if (!client->title_utf8 && !props_title(client->title, reply))
+                client->title[0] = '\0';
+            free(reply);
+        }
+
+        reply = props_refresh_reply(&client->bypass_sequence, &arrived);
+        if (arrived)
+        {
+            client_bypass_compositor(client, reply != NULL && reply->format == 32 &&
+                                                     xcb_get_property_value_length(reply) >= 4
+                                                 ? *(uint32_t *)xcb_get_property_value(reply)
+                                                 : BYPASS_COMPOSITOR_NONE);
+            free(reply);
+        }
+
+        if (client->hints_sequence == 0 && client->protocols_sequence == 0 &&
+            client->name_sequence == 0 && client->net_name_sequence == 0 &&
+            client->bypass_sequence == 0)
+        {
+            *p = client->refreshing_next;
+            client->refreshing = false;
+        }
+        else
+            p = &client->refreshing_next;
+    }
+}
+
+// Hand the fetched properties to the clients, called at the end of each event batch
+void props_poll()
+{
+    props_poll_refreshed();
+
+    // No worker: the event loop fetches the queued windows itself, still in batches
+    if (!worker_running)
+    {
+        xcb_window_t windows[PROPS_BATCH_SIZE];
+        props batch[PROPS_BATCH_SIZE];
+        uint_fast8_t length;
+
+        while ((length = request_pop_batch(windows)) != 0)
+        {
+            props_fetch(c, windows, length, batch);
+            for (uint_fast8_t i = 0; i != length; i++)
+                client_properties(&batch[i]);
+        }
+
+        return;
+    }
+
+    props props;
+    while (result_pop(&props))
+        client_properties(&props);
+}
+
+void props_close()
+{
+    if (!worker_running)
+        return; // Nothing to be done
+
+    __atomic_store_n(&worker_stop, true, __ATOMIC_RELEASE);
+    if (write(worker_pipe[1], "", 1) == -1)
+        perror("props_close");
+
+    pthread_join(worker, NULL);
+    close(worker_pipe[0]);
+    close(worker_pipe[1]);
+    xcb_disconnect(worker_c);
+    worker_running = false;
+}
@@ -0,0 +1,68 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "snapshot.h"
+#include <stdbool.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_icccm.h>
+
+/*
+ * Properties of new windows, fetched by a worker thread on its own connection so the event loop
+ * never waits on a client. The results come back through a lock-free queue, props_poll() hands
+ * them to client_properties().
+ */
+
+#define PROPS_NAME_SIZE 128
+#define PROPS_BATCH_SIZE 32 // Windows fetched with one round trip
+#define PROPS_STATE_SIZE 16 // Atoms of _NET_WM_STATE looked at
+
+typedef struct
+{
+    xcb_window_t window;
+    bool has_hints;
+    xcb_size_hints_t hints;
+    bool has_class; // WM_CLASS and WM_WINDOW_ROLE are only fetched for rules, the pool or places
+    char class_name[PROPS_NAME_SIZE];
+    char instance_name[PROPS_NAME_SIZE];
+    bool has_role;
+    char role[PROPS_NAME_SIZE];
+    xcb_visualid_t visual; // Only fetched when the overview is available, 0 otherwise
+    bool ping;             // WM_PROTOCOLS has _NET_WM_PING
+    char title[SNAPSHOT_TITLE_SIZE]; // Only fetched for the snapshot, empty otherwise
+    bool title_utf8;                 // From _NET_WM_NAME
+    uint32_t pid;                    // _NET_WM_PID, only fetched for the pool, 0 otherwise
+    bool fullscreen;                 // _NET_WM_STATE has _NET_WM_STATE_FULLSCREEN
+    xcb_atom_t states[PROPS_STATE_SIZE]; // The other atoms of _NET_WM_STATE
+    uint8_t states_length;
+} props;
+
+/*
+ * Properties changed later, as told by PropertyNotify: only the one that changed is refetched, on
+ * the connection of the event loop, and its reply is only polled for by props_poll()
+ */
+
+struct client_t; // client.h includes this file
+
+void setup_props();
+void props_request(xcb_window_t);
+void props_refresh(struct client_t *, xcb_atom_t);
+void props_forget(struct client_t *);
+void props_poll();
+void props_close();
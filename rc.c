@@ -0,0 +1,689 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rc.h"
+#include "chord.h"
+#include "client.h"
+#include "kbgwm.h"
+#include "layout.h"
+#include "overview.h"
+#include "pool.h"
+#include "xcbutils.h"
+
+#include <X11/keysym.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+typedef enum
+{
+    ARG_NONE,
+    ARG_BOOL,
+    ARG_INT,
+    ARG_DIRECTION,
+    ARG_LAYOUT,
+    ARG_CMD
+} arg_type;
+
+typedef struct
+{
+    const char *name;
+    void (*func)(const Arg *);
+    arg_type type;
+} action;
+
+static const action actions[] = {
+    {"start", start, ARG_CMD},
+    {"terminal", terminal, ARG_CMD},
+    {"mousemove", mousemove, ARG_NONE},
+    {"mouseresize", mouseresize, ARG_NONE},
+    {"keymove", keymove, ARG_DIRECTION},
+    {"keyresize", keyresize, ARG_DIRECTION},
+    {"focus_next", focus_next, ARG_BOOL},
+    {"client_kill", client_kill, ARG_NONE},
+    {"client_toggle_maximize", client_toggle_maximize, ARG_NONE},
+    {"client_toggle_fullscreen", client_toggle_fullscreen, ARG_NONE},
+    {"quit", quit, ARG_NONE},
+    {"workspace_change", workspace_change, ARG_INT},
+    {"workspace_send", workspace_send, ARG_INT},
+    {"workspace_next", workspace_next, ARG_NONE},
+    {"workspace_previous", workspace_previous, ARG_NONE},
+    {"workspace_next_occupied", workspace_next_occupied, ARG_NONE},
+    {"workspace_previous_occupied", workspace_previous_occupied, ARG_NONE},
+    {"workspace_free", workspace_free, ARG_NONE},
+    {"workspace_send_free", workspace_send_free, ARG_NONE},
+    {"overview", overview, ARG_NONE},
+    {"layout", layout, ARG_LAYOUT},
+};
+
+// clang-format off
+static const struct
+{
+    const char *name;
+    uint16_t mask;
+} modifier_names[] = {
+    { "Shift", XCB_MOD_MASK_SHIFT }, { "Lock", XCB_MOD_MASK_LOCK },
+    { "Control", XCB_MOD_MASK_CONTROL },
+    { "Mod1",  XCB_MOD_MASK_1 },     { "Mod2", XCB_MOD_MASK_2 },
+    { "Mod3",  XCB_MOD_MASK_3 },     { "Mod4", XCB_MOD_MASK_4 },
+    { "Mod5",  XCB_MOD_MASK_5 },     { "None", 0 },
+};
+
+// Keysyms that are not a single character, the others can be given as 0x hexadecimal values
+static const struct
+{
+    const char *name;
+    xcb_keysym_t keysym;
+} keysym_names[] = {
+    { "Return",  XK_Return },  { "Tab",       XK_Tab },       { "Escape",    XK_Escape },
+    { "space",   XK_space },   { "BackSpace", XK_BackSpace }, { "Delete",    XK_Delete },
+    { "Insert",  XK_Insert },  { "Home",      XK_Home },      { "End",       XK_End },
+    { "Page_Up", XK_Page_Up }, { "Page_Down", XK_Page_Down }, { "Print",     XK_Print },
+    { "Left",    XK_Left },    { "Right",     XK_Right },     { "Up",        XK_Up },
+    { "Down",    XK_Down },    { "F1",        XK_F1 },        { "F2",        XK_F2 },
+    { "F3",      XK_F3 },      { "F4",        XK_F4 },        { "F5",        XK_F5 },
+    { "F6",      XK_F6 },      { "F7",        XK_F7 },        { "F8",        XK_F8 },
+    { "F9",      XK_F9 },      { "F10",       XK_F10 },       { "F11",       XK_F11 },
+    { "F12",     XK_F12 },
+};
+// clang-format on
+
+static const char *directions[] = {
+    [DIRECTION_LEFT] = "left",
+    [DIRECTION_RIGHT] = "right",
+    [DIRECTION_UP] = "up",
+    [DIRECTION_DOWN] = "down",
+};
+
+static const char *layout_names[] = {
+    [LAYOUT_FLOATING] = "floating",
+    [LAYOUT_MASTER] = "master",
+    [LAYOUT_GRID] = "grid",
+};
+
+/*
+ * A parsed configuration, keys and buttons are NULL when the file does not override the defaults.
+ * The commands point into buffer, the content of the file.
+ */
+typedef struct
+{
+    Key *keys;
+    uint_least8_t keys_length;
+    Chord *chords; // Set along with keys
+    uint_least8_t chords_length;
+    Button *buttons;
+    uint_least8_t buttons_length;
+    uint32_t focus_color;
+    uint32_t unfocus_color;
+    uint32_t hung_color;
+    uint32_t kill_timeout;
+    uint_least8_t border_width;
+    uint_least8_t workspaces;
+    char *buffer;
+    const char **argv;
+} configuration;
+
+static char *path = NULL;
+static configuration current = {0};
+static volatile sig_atomic_t reload_requested = 0;
+
+static void config_free(configuration *config)
+{
+    free(config->keys);
+    free(config->chords);
+    free(config->buttons);
+    free(config->buffer);
+    free(config->argv);
+}
+
+static char *config_read(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+
+    char *buffer = NULL;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        long length = ftell(file);
+        rewind(file);
+
+        if (length >= 0 && (buffer = malloc(length + 1)) != NULL)
+        {
+            *size = fread(buffer, 1, length, file);
+            buffer[*size] = '\0';
+        }
+    }
+
+    fclose(file);
+    return buffer;
+}
+
+static bool parse_number(const char *string, unsigned long max, unsigned long *value)
+{
+    char *end;
+    *value = strtoul(string, &end, 0);
+    return *string != '\0' && *end == '\0' && *value <= max;
+}
+
+// #rrggbb, or any number strtoul() understands
+static bool parse_color(const char *string, uint32_t *color)
+{
+    int base = 0;
+    if (*string == '#')
+    {
+        string++;
+        base = 16;
+    }
+
+    char *end;
+    unsigned long value = strtoul(string, &end, base);
+    if (*string == '\0' || *end != '\0' || value > 0xFFFFFF)
+        return false;
+
+    *color = value;
+    return true;
+}
+
+static bool parse_modifiers(char *string, uint16_t *modifiers)
+{
+    char *saveptr;
+    *modifiers = 0;
+
+    for (char *name = strtok_r(string, "+", &saveptr); name != NULL;
+         name = strtok_r(NULL, "+", &saveptr))
+    {
+        uint_fast8_t i = 0;
+        while (i != LENGTH(modifier_names) && strcasecmp(name, modifier_names[i].name) != 0)
+            i++;
+
+        if (i == LENGTH(modifier_names))
+            return false;
+
+        *modifiers |= modifier_names[i].mask;
+    }
+
+    return true;
+}
+
+static bool parse_keysym(const char *string, xcb_keysym_t *keysym)
+{
+    // Latin-1 characters are their own keysym
+    if (string[0] != '\0' && string[1] == '\0')
+    {
+        *keysym = (uint8_t)string[0];
+        return true;
+    }
+
+    for (uint_fast8_t i = 0; i != LENGTH(keysym_names); i++)
+        if (strcmp(string, keysym_names[i].name) == 0)
+        {
+            *keysym = keysym_names[i].keysym;
+            return true;
+        }
+
+    unsigned long value;
+    if (strncmp(string, "0x", 2) != 0 || !parse_number(string, UINT32_MAX, &value))
+        return false;
+
+    *keysym = value;
+    return true;
+}
+
+// Parse the action named name and its argument, the tokens left on the line
+static const char *parse_action(char *name, char **saveptr, const char ***argv,
+                                void (**func)(const Arg *), Arg *arg)
+{
+    if (name == NULL)
+        return "missing action";
+
+    const action *action = NULL;
+    for (uint_fast8_t i = 0; i != LENGTH(actions); i++)
+        if (strcmp(name, actions[i].name) == 0)
+            action = &actions[i];
+
+    if (action == NULL)
+        return "unknown action";
+
+    *func = action->func;
+    char *value = strtok_r(NULL, " \t", saveptr);
+    unsigned long number;
+
+    switch (action->type)
+    {
+    case ARG_NONE:
+        memcpy(arg, &(Arg){0}, sizeof(Arg));
+        return value == NULL ? NULL : "unexpected argument";
+
+    case ARG_BOOL:
+        if (value == NULL || strcmp(value, "false") == 0)
+            memcpy(arg, &(Arg){.b = false}, sizeof(Arg));
+        else if (strcmp(value, "true") == 0)
+            memcpy(arg, &(Arg){.b = true}, sizeof(Arg));
+        else
+            return "expected true or false";
+        return NULL;
+
+    case ARG_INT:
+        if (value == NULL || !parse_number(value, UINT8_MAX, &number))
+            return "expected a number";
+        memcpy(arg, &(Arg){.i = number}, sizeof(Arg));
+        return NULL;
+
+    case ARG_DIRECTION:
+        for (uint_fast8_t i = 0; value != NULL && i != LENGTH(directions); i++)
+            if (strcmp(value, directions[i]) == 0)
+            {
+                memcpy(arg, &(Arg){.i = i}, sizeof(Arg));
+                return NULL;
+            }
+        return "expected left, right, up or down";
+
+    case ARG_LAYOUT:
+        for (uint_fast8_t i = 0; value != NULL && i != LENGTH(layout_names); i++)
+            if (strcmp(value, layout_names[i]) == 0)
+            {
+                memcpy(arg, &(Arg){.i = i}, sizeof(Arg));
+                return NULL;
+            }
+        return "expected floating, master or grid";
+
+    case ARG_CMD:
+        if (value == NULL)
+            return "missing command";
+
+        // The command is the rest of the line, NULL terminated
+        memcpy(arg, &(Arg){.cmd = *argv}, sizeof(Arg));
+        for (; value != NULL; value = strtok_r(NULL, " \t", saveptr))
+            *(*argv)++ = value;
+        *(*argv)++ = NULL;
+        return NULL;
+    }
+
+    return "unknown action";
+}
+
+// Parse one line of the configuration file, returns an error message or NULL
+static const char *parse_line(configuration *config, char *line, const char ***argv)
+{
+    char *saveptr;
+    char *directive = strtok_r(line, " \t", &saveptr);
+
+    // Empty line or comment
+    if (directive == NULL || directive[0] == '#')
+        return NULL;
+
+    if (strcmp(directive, "key") == 0 || strcmp(directive, "button") == 0)
+    {
+        bool key = directive[0] == 'k';
+        char *modifiers_string = strtok_r(NULL, " \t", &saveptr);
+        char *keysym_string = strtok_r(NULL, " \t", &saveptr);
+        uint16_t modifiers;
+        xcb_keysym_t keysym = 0;
+        unsigned long button = 0;
+        void (*func)(const Arg *);
+        Arg arg;
+
+        if (modifiers_string == NULL || !parse_modifiers(modifiers_string, &modifiers))
+            return "invalid modifiers";
+
+        if (key ? keysym_string == NULL || !parse_keysym(keysym_string, &keysym)
+                : keysym_string == NULL || !parse_number(keysym_string, 5, &button) || button == 0)
+            return key ? "invalid keysym" : "invalid button";
+
+        // A chord: "then <modifiers> <keysym>" for each following key
+        Stroke strokes[KEY_CHORD_MAX] = {{modifiers, keysym}};
+        uint_fast8_t length = 1;
+        char *action = strtok_r(NULL, " \t", &saveptr);
+        for (; key && action != NULL && strcmp(action, "then") == 0; length++)
+        {
+            if (length == KEY_CHORD_MAX)
+                return "chord too long";
+
+            modifiers_string = strtok_r(NULL, " \t", &saveptr);
+            keysym_string = strtok_r(NULL, " \t", &saveptr);
+            if (modifiers_string == NULL || !parse_modifiers(modifiers_string, &modifiers))
+                return "invalid modifiers";
+            if (keysym_string == NULL || !parse_keysym(keysym_string, &keysym))
+                return "invalid keysym";
+
+            strokes[length] = (Stroke){modifiers, keysym};
+            action = strtok_r(NULL, " \t", &saveptr);
+        }
+
+        const char *error = parse_action(action, &saveptr, argv, &func, &arg);
+        if (error != NULL)
+            return error;
+
+        if (key && length > 1)
+        {
+            if (config->chords_length == UINT8_MAX)
+                return "too many chords";
+            Chord *chord = &config->chords[config->chords_length++];
+            memcpy(chord, &(Chord){.func = func, .arg = arg}, sizeof(Chord));
+            memcpy(chord->strokes, strokes, sizeof(strokes));
+        }
+        else if (key)
+        {
+            if (config->keys_length == UINT8_MAX)
+                return "too many keys";
+            memcpy(&config->keys[config->keys_length++],
+                   &(Key){strokes[0].modifiers, strokes[0].keysym, func, arg}, sizeof(Key));
+        }
+        else
+        {
+            if (config->buttons_length == UINT8_MAX)
+                return "too many buttons";
+            memcpy(&config->buttons[config->buttons_length++],
+                   &(Button){modifiers, button, func, arg}, sizeof(Button));
+        }
+
+        return NULL;
+    }
+
+    char *value = strtok_r(NULL, " \t", &saveptr);
+    if (value == NULL)
+        return "missing value";
+    if (strtok_r(NULL, " \t", &saveptr) != NULL)
+        return "unexpected argument";
+
+    unsigned long number;
+
+    if (strcmp(directive, "border_width") == 0)
+    {
+        if (!parse_number(value, UINT8_MAX, &number))
+            return "invalid border width";
+        config->border_width = number;
+    }
+    else if (strcmp(directive, "focus_color") == 0)
+    {
+        if (!parse_color(value, &config->focus_color))
+            return "invalid color";
+    }
+    else if (strcmp(directive, "unfocus_color") == 0)
+    {
+        if (!parse_color(value, &config->unfocus_color))
+            return "invalid color";
+    }
+    else if (strcmp(directive, "hung_color") == 0)
+    {
+        if (!parse_color(value, &config->hung_color))
+            return "invalid color";
+    }
+    else if (strcmp(directive, "kill_timeout") == 0)
+    {
+        if (!parse_number(value, UINT32_MAX, &number))
+            return "invalid timeout";
+        config->kill_timeout = number;
+    }
+    else if (strcmp(directive, "workspaces") == 0)
+    {
+        if (!parse_number(value, workspaces_max, &number) || number == 0)
+            return "invalid number of workspaces";
+        config->workspaces = number;
+    }
+    else
+        return "unknown directive";
+
+    return NULL;
+}
+
+// Parse the configuration file, the settings it does not mention keep their default value
+static bool config_parse(configuration *config)
+{
+    *config = (configuration){.focus_color = default_focus_color,
+                              .unfocus_color = default_unfocus_color,
+                              .hung_color = default_hung_color,
+                              .kill_timeout = default_kill_timeout,
+                              .border_width = default_border_width,
+                              .workspaces = default_workspaces_min};
+
+    size_t size;
+    config->buffer = config_read(path, &size);
+    if (config->buffer == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    // There can't be more keys, buttons or command arguments than characters in the file
+    size_t entries = size < UINT8_MAX ? size + 1 : UINT8_MAX;
+    config->keys = malloc(entries * sizeof(Key));
+    config->chords = malloc(entries * sizeof(Chord));
+    config->buttons = malloc(entries * sizeof(Button));
+    config->argv = malloc((size + 1) * sizeof(char *));
+    if (config->keys == NULL || config->chords == NULL || config->buttons == NULL ||
+        config->argv == NULL)
+    {
+        perror("config_parse");
+        config_free(config);
+        return false;
+    }
+
+    const char **argv = config->argv;
+    unsigned int line_number = 1;
+
+    for (char *line = config->buffer; *line != '\0'; line_number++)
+    {
+        char *end = strchr(line, '\n');
+        if (end != NULL)
+            *end = '\0';
+
+        const char *error = parse_line(config, line, &argv);
+        if (error != NULL)
+        {
+            fprintf(stderr, "%s:%u: %s\n", path, line_number, error);
+            config_free(config);
+            return false;
+        }
+
+        if (end == NULL)
+            break;
+        line = end + 1;
+    }
+
+    // No binding in the file -> keep the default ones
+    if (config->keys_length == 0 && config->chords_length == 0)
+    {
+        free(config->keys);
+        free(config->chords);
+        config->keys = NULL;
+        config->chords = NULL;
+    }
+
+    if (config->buttons_length == 0)
+    {
+        free(config->buttons);
+        config->buttons = NULL;
+    }
+
+    return true;
+}
+
+static bool button_find(const Button *buttons, uint_fast8_t length, const Button *button)
+{
+    for (uint_fast8_t i = 0; i != length; i++)
+        if (buttons[i].modifiers == button->modifiers && buttons[i].keysym == button->keysym)
+            return true;
+
+    return false;
+}
+
+// Make a parsed configuration the current one
+static void config_use(configuration *config)
+{
+    keys = config->keys != NULL ? config->keys : default_keys;
+    keys_length = config->keys != NULL ? config->keys_length : default_keys_length;
+    chords = config->chords != NULL ? config->chords : default_chords;
+    chords_length = config->chords != NULL ? config->chords_length : default_chords_length;
+    buttons = config->buttons != NULL ? config->buttons : default_buttons;
+    buttons_length = config->buttons != NULL ? config->buttons_length : default_buttons_length;
+    focus_color = config->focus_color;
+    unfocus_color = config->unfocus_color;
+    hung_color = config->hung_color;
+    kill_timeout = config->kill_timeout;
+    border_width = config->border_width;
+    border_width_x2 = config->border_width << 1;
+    // The workspaces above it go away once empty, see workspace_trim()
+    workspaces_min = config->workspaces;
+    if (workspaces_length < workspaces_min)
+        workspaces_length = workspaces_min;
+
+    config_free(&current);
+    current = *config;
+}
+
+// Go from the current configuration to a new one, only sending the requests for what changed
+static void config_apply(configuration *config)
+{
+    const Button *new_buttons = config->buttons != NULL ? config->buttons : default_buttons;
+    uint_fast8_t new_buttons_length =
+        config->buttons != NULL ? config->buttons_length : default_buttons_length;
+
+    // Buttons are grabbed on the root window, keys too once the bindings are compiled below
+    for (uint_fast8_t i = 0; i != buttons_length; i++)
+        if (!button_find(new_buttons, new_buttons_length, &buttons[i]))
+            xcb_unregister_button_events(buttons[i]);
+
+    for (uint_fast8_t i = 0; i != new_buttons_length; i++)
+        if (!button_find(buttons, buttons_length, &new_buttons[i]))
+            xcb_register_button_events(new_buttons[i]);
+
+    bool focus_color_changed = config->focus_color != focus_color;
+    bool unfocus_color_changed = config->unfocus_color != unfocus_color;
+    bool hung_color_changed = config->hung_color != hung_color;
+    bool border_width_changed = config->border_width != border_width;
+    border_width = config->border_width;
+    border_width_x2 = config->border_width << 1;
+
+    for (uint_fast8_t workspace = 0; workspace != workspaces_length; workspace++)
+    {
+        client *focused = workspaces[workspace];
+        if (focused == NULL)
+            continue;
+
+        client *client = focused;
+        do
+        {
+            uint32_t color = client == focused ? config->focus_color : config->unfocus_color;
+            bool color_changed = client == focused ? focus_color_changed : unfocus_color_changed;
+            if (client->hung)
+            {
+                color = config->hung_color;
+                color_changed = hung_color_changed;
+            }
+
+            if (color_changed)
+                xcb_change_window_attributes(c, client->id, XCB_CW_BORDER_PIXEL,
+                                             (uint32_t[]){0xFF000000 | color});
+
+            // Maximized clients have no border
+            if (border_width_changed && !client->maximized && !client->fullscreen)
+            {
+                xcb_configure_window(c, client->id, XCB_CONFIG_WINDOW_BORDER_WIDTH,
+                                     (uint32_t[]){border_width});
+                client_sanitize_position(client);
+                client_sanitize_dimensions(client);
+                client_configure_defer(client, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+                                                   XCB_CONFIG_WINDOW_WIDTH |
+                                                   XCB_CONFIG_WINDOW_HEIGHT);
+            }
+        } while ((client = client->next) != focused);
+
+        // The tiles lose or gain the border difference
+        if (border_width_changed)
+            layout_dirty(workspace);
+    }
+
+    config_use(config);
+    chord_compile();
+}
+
+static void handle_sighup(__attribute__((unused)) int signal)
+{
+    reload_requested = 1;
+    event_wake();
+}
+
+void setup_rc(const char *config_path)
+{
+    struct sigaction action = {.sa_handler = handle_sighup, .sa_flags = SA_RESTART};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGHUP, &action, NULL);
+
+    // $XDG_CONFIG_HOME/kbgwm/kbgwmrc, or ~/.config/kbgwm/kbgwmrc when it is not set
+    const char *directory = getenv("XDG_CONFIG_HOME");
+    const char *format = "%s/kbgwm/kbgwmrc";
+    if (directory == NULL && (directory = getenv("HOME")) != NULL)
+        format = "%s/.config/kbgwm/kbgwmrc";
+
+    if (config_path != NULL)
+        path = strdup(config_path);
+    else if (directory != NULL)
+    {
+        size_t length = strlen(directory) + sizeof("/.config/kbgwm/kbgwmrc");
+        if ((path = malloc(length)) != NULL)
+            snprintf(path, length, format, directory);
+
+        // No configuration file -> the defaults from config.h, until the next reload
+        if (path != NULL && access(path, F_OK) != 0)
+        {
+            printf("setup_rc: no configuration file %s\n", path);
+            return;
+        }
+    }
+
+    if (path == NULL)
+        return; // Nothing to be done
+
+    configuration config;
+    if (config_parse(&config))
+        config_use(&config);
+}
+
+void rc_reload()
+{
+    printf("=======[ user action: rc_reload ]=======\n");
+
+    if (path == NULL)
+        return; // Nothing to be done
+
+    // Keep the current configuration if the file can't be used
+    configuration config;
+    if (!config_parse(&config))
+        return;
+
+    config_apply(&config);
+    printf("rc_reload: done\n");
+}
+
+// Reload requested by SIGHUP, called from the event loop
+void rc_poll()
+{
+    if (!reload_requested)
+        return; // Nothing to be done
+
+    reload_requested = 0;
+    rc_reload();
+}
@@ -0,0 +1,208 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "record.h"
+#include "xcbutils.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Log format:
+ * - header: RECORD_MAGIC
+ * - records: uint32_t microseconds since the previous record, uint32_t size, then size bytes of
+ *   event as returned by xcb. A record of size 0 marks the end of an event batch.
+ */
+
+#define RECORD_MAGIC "kbgwmev1"
+#define RECORD_MAGIC_LENGTH 8
+#define RECORD_SIZE_MAX 65536 // Far above the largest event, a bigger record is a corrupt log
+
+typedef struct
+{
+    uint32_t delay;
+    uint32_t size;
+} record_header;
+
+static FILE *record_file = NULL;
+static FILE *replay_file = NULL;
+static uint64_t previous_time;
+static uint64_t replay_start;
+static uint64_t replay_elapsed;
+
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// xcb stores the full sequence number right after the 32 bytes of the event, generic events have
+// their additional data after it
+static uint32_t event_size(const xcb_generic_event_t *event)
+{
+    uint32_t size = sizeof(xcb_generic_event_t);
+
+    if ((event->response_type & ~0x80) == XCB_GE_GENERIC)
+        size += ((const xcb_ge_generic_event_t *)event)->length * 4;
+
+    return size;
+}
+
+static void record_write(const void *data, uint32_t size)
+{
+    uint64_t time = now();
+    uint64_t delay = time - previous_time;
+    previous_time = time;
+
+    record_header header = {delay > UINT32_MAX ? UINT32_MAX : delay, size};
+
+    if (fwrite(&header, sizeof(header), 1, record_file) != 1 ||
+        (size != 0 && fwrite(data, size, 1, record_file) != 1))
+    {
+        perror("record");
+        record_close();
+    }
+}
+
+bool record_open(const char *path)
+{
+    if (!(record_file = fopen(path, "wb")))
+    {
+        perror(path);
+        return false;
+    }
+
+    if (fwrite(RECORD_MAGIC, RECORD_MAGIC_LENGTH, 1, record_file) != 1)
+    {
+        perror(path);
+        record_close();
+        return false;
+    }
+
+    previous_time = now();
+    return true;
+}
+
+void record_event(const xcb_generic_event_t *event)
+{
+    // Not recording
+    if (record_file == NULL)
+        return; // Nothing to be done
+
+    record_write(event, event_size(event));
+}
+
+void record_batch_end()
+{
+    // Not recording
+    if (record_file == NULL)
+        return; // Nothing to be done
+
+    record_write(NULL, 0);
+}
+
+void record_close()
+{
+    if (record_file == NULL)
+        return; // Nothing to be done
+
+    fclose(record_file);
+    record_file = NULL;
+}
+
+bool replay_open(const char *path)
+{
+    char magic[RECORD_MAGIC_LENGTH];
+
+    if (!(replay_file = fopen(path, "rb")))
+    {
+        perror(path);
+        return false;
+    }
+
+    if (fread(magic, RECORD_MAGIC_LENGTH, 1, replay_file) != 1 ||
+        memcmp(magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH) != 0)
+    {
+        printf("%s: not an event log\n", path);
+        replay_close();
+        return false;
+    }
+
+    replay_start = now();
+    replay_elapsed = 0;
+    return true;
+}
+
+// Read the next record, when paced wait until it is due according to the recorded delays
+replay_result replay_next(xcb_generic_event_t **event, bool paced)
+{
+    record_header header;
+
+    if (fread(&header, sizeof(header), 1, replay_file) != 1)
+        return REPLAY_EOF;
+
+    replay_elapsed += header.delay;
+
+    if (paced)
+    {
+        uint64_t time = now();
+        uint64_t due = replay_start + replay_elapsed;
+
+        if (due > time)
+        {
+            struct timespec ts = {(due - time) / 1000000, (due - time) % 1000000 * 1000};
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    if (header.size == 0)
+        return REPLAY_BATCH_END;
+
+    if (header.size > RECORD_SIZE_MAX)
+    {
+        printf("replay: corrupt record of %" PRIu32 " bytes, stopping\n", header.size);
+        return REPLAY_EOF;
+    }
+
+    // Never hand out less than a full event, handlers cast it to their own type
+    *event = emalloc(header.size < sizeof(xcb_generic_event_t) ? sizeof(xcb_generic_event_t)
+                                                                 : header.size);
+    if (fread(*event, header.size, 1, replay_file) != 1)
+    {
+        free(*event);
+        return REPLAY_EOF;
+    }
+
+    return REPLAY_EVENT;
+}
+
+void replay_close()
+{
+    if (replay_file == NULL)
+        return; // Nothing to be done
+
+    fclose(replay_file);
+    replay_file = NULL;
+}
@@ -0,0 +1,45 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+/*
+ * Recording: every event received is appended to the log, with the time elapsed since the
+ * previous one. The end of each event batch is recorded as well.
+ */
+bool record_open(const char *);
+void record_event(const xcb_generic_event_t *);
+void record_batch_end();
+void record_close();
+
+/*
+ * Replay: read back a log written by the recorder
+ */
+typedef enum
+{
+    REPLAY_EVENT,
+    REPLAY_BATCH_END,
+    REPLAY_EOF
+} replay_result;
+
+bool replay_open(const char *);
+replay_result replay_next(xcb_generic_event_t **, bool);
+void replay_close();
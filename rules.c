@@ -0,0 +1,164 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rules.h"
+#include "kbgwm.h"
+#include "xcbutils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Index + 1 of the first rule of each class, 0 for empty slots
+static uint_least8_t *table = NULL;
+// Index + 1 of the next rule of the same class
+static uint_least8_t *next = NULL;
+// Index + 1 of the first rule without a class, they are chained through next too
+static uint_least8_t wildcards = 0;
+static uint32_t table_mask;
+static uint32_t seed;
+
+// FNV-1a, seeded
+static uint32_t hash(const char *string, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+
+    while (*string)
+    {
+        hash ^= (uint8_t)*string++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Try to place every class with the current seed, fails on the first collision
+static bool table_fill()
+{
+    memset(table, 0, (table_mask + 1) * sizeof(*table));
+
+    for (uint_fast8_t i = 0; i != rules_length; i++)
+    {
+        // Matches any class, kept out of the table
+        if (rules[i].class == NULL)
+            continue;
+
+        uint32_t slot = hash(rules[i].class, seed) & table_mask;
+
+        if (table[slot] == 0)
+            table[slot] = i + 1;
+
+        // The class already has a rule, chain this one after the last of them
+        else if (strcmp(rules[table[slot] - 1].class, rules[i].class) == 0)
+        {
+            uint_fast8_t j = table[slot] - 1;
+            while (next[j] != 0)
+                j = next[j] - 1;
+            next[j] = i + 1;
+        }
+
+        else
+            return false;
+    }
+
+    return true;
+}
+
+// Chain the rules without a class, in their order
+static void wildcards_fill()
+{
+    uint_least8_t *last = &wildcards;
+
+    for (uint_fast8_t i = 0; i != rules_length; i++)
+    {
+        if (rules[i].class != NULL)
+            continue;
+
+        *last = i + 1;
+        last = &next[i];
+    }
+}
+
+// Find a seed for which no two classes share a slot, growing the table if it takes too long
+void setup_rules()
+{
+    if (rules_length == 0)
+        return; // Nothing to be done
+
+    uint32_t size = 2;
+    while (size < 2u * rules_length)
+        size <<= 1;
+
+    next = emalloc(rules_length * sizeof(*next));
+
+    for (;; size <<= 1)
+    {
+        free(table);
+        table = emalloc(size * sizeof(*table));
+        table_mask = size - 1;
+
+        for (seed = 0; seed != 256; seed++)
+        {
+            memset(next, 0, rules_length * sizeof(*next));
+            if (table_fill())
+            {
+                wildcards_fill();
+                printf("setup_rules: %d rules, %u slots, seed %u\n", rules_length, size, seed);
+                return;
+            }
+        }
+    }
+}
+
+static bool rule_match(const char *pattern, const char *value)
+{
+    return pattern == NULL || (value != NULL && strcmp(pattern, value) == 0);
+}
+
+// First rule of a chain matching a window, NULL if there is none
+static const Rule *chain_find(uint_fast8_t i, const char *instance, const char *role)
+{
+    for (; i != 0; i = next[i - 1])
+    {
+        const Rule *rule = &rules[i - 1];
+        if (rule_match(rule->instance, instance) && rule_match(rule->role, role))
+            return rule;
+    }
+
+    return NULL;
+}
+
+// Find the first rule matching a window, NULL if there is none
+const Rule *rule_find(const char *class, const char *instance, const char *role)
+{
+    if (rules_length == 0)
+        return NULL;
+
+    const Rule *rule = NULL;
+    if (class != NULL)
+    {
+        uint_fast8_t i = table[hash(class, seed) & table_mask];
+        if (i != 0 && strcmp(rules[i - 1].class, class) == 0)
+            rule = chain_find(i, instance, role);
+    }
+
+    // A rule without a class comes first if it is before in the table
+    const Rule *wildcard = chain_find(wildcards, instance, role);
+    return wildcard != NULL && (rule == NULL || wildcard < rule) ? wildcard : rule;
+}
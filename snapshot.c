@@ -0,0 +1,168 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "snapshot.h"
+#include "client.h"
+#include "kbgwm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static snapshot_file *file = NULL;
+static char *path = NULL;
+
+// Built at the end of each batch, written to the file only when it differs
+static snapshot_state staging;
+
+void setup_snapshot()
+{
+    if (!snapshot_enabled)
+        return; // Nothing to be done
+
+    const char *directory = getenv("XDG_RUNTIME_DIR");
+    if (directory == NULL)
+    {
+        printf("setup_snapshot: XDG_RUNTIME_DIR is not set, no snapshot\n");
+        return;
+    }
+
+    size_t length = strlen(directory) + sizeof("/kbgwm/snapshot");
+    if ((path = malloc(length)) == NULL)
+    {
+        perror("setup_snapshot");
+        return;
+    }
+
+    snprintf(path, length, "%s/kbgwm", directory);
+    if (mkdir(path, 0700) == -1 && errno != EEXIST)
+    {
+        perror(path);
+        free(path);
+        path = NULL;
+        return;
+    }
+    strcat(path, "/snapshot");
+
+    // A new file: the readers of a previous one are not mistaken for readers of this one
+    unlink(path);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1 || ftruncate(fd, sizeof(snapshot_file)) == -1)
+    {
+        perror(path);
+        if (fd != -1)
+            close(fd);
+        free(path);
+        path = NULL;
+        return;
+    }
+
+    void *mapping = mmap(NULL, sizeof(snapshot_file), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror(path);
+        free(path);
+        path = NULL;
+        return;
+    }
+
+    file = mapping;
+    memcpy(file->magic, SNAPSHOT_MAGIC, sizeof(file->magic));
+
+    printf("setup_snapshot: %s\n", path);
+}
+
+// Read by the properties worker too, set before it starts
+bool snapshot_active()
+{
+    return file != NULL;
+}
+
+// Write the state if it changed since the last time, called at the end of each event batch
+void snapshot_publish()
+{
+    if (file == NULL)
+        return; // Nothing to be done
+
+    staging.focused = focused_client != NULL ? focused_client->id : 0;
+    staging.current_workspace = current_workspace;
+    staging.workspaces_length = workspaces_length;
+    staging.occupied = workspaces_occupied;
+
+    uint_fast16_t length = 0;
+    for (uint64_t occupied = workspaces_occupied; occupied != 0; occupied &= occupied - 1)
+    {
+        uint_fast8_t workspace = __builtin_ctzll(occupied);
+        client *client = workspaces[workspace];
+
+        do
+        {
+            if (length == SNAPSHOT_CLIENTS)
+                break;
+
+            snapshot_client *entry = &staging.clients[length++];
+            entry->id = client->id;
+            entry->x = client->x;
+            entry->y = client->y;
+            entry->width = client->width;
+            entry->height = client->height;
+            entry->workspace = workspace;
+            entry->flags = (client == workspaces[workspace] ? SNAPSHOT_FOCUSED : 0) |
+                           (client->maximized ? SNAPSHOT_MAXIMIZED : 0) |
+                           (client->fullscreen ? SNAPSHOT_FULLSCREEN : 0) |
+                           (client->tiled ? SNAPSHOT_TILED : 0) |
+                           (client->hung ? SNAPSHOT_HUNG : 0);
+            // Zero padded, the comparison below goes through the whole entry
+            strncpy(entry->title, client->title, SNAPSHOT_TITLE_SIZE);
+        } while ((client = client->next) != workspaces[workspace]);
+    }
+    staging.clients_length = length;
+
+    // Only the clients there are, the entries after them are left as they are
+    size_t size = offsetof(snapshot_state, clients) + length * sizeof(snapshot_client);
+    if (memcmp(&file->state, &staging, size) == 0)
+        return; // Nothing changed
+
+    // Seqlock: odd while writing, readers retry when it is odd or changed during their copy
+    uint32_t sequence = file->sequence;
+    __atomic_store_n(&file->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&file->state, &staging, size);
+    __atomic_store_n(&file->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// The file goes away with kbgwm, readers find it missing
+void snapshot_close()
+{
+    if (file == NULL)
+        return; // Nothing to be done
+
+    munmap(file, sizeof(snapshot_file));
+    unlink(path);
+    free(path);
+    file = NULL;
+}
@@ -0,0 +1,73 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * State snapshot for bars and scripts: the workspaces, their clients and the focus, published in
+ * $XDG_RUNTIME_DIR/kbgwm/snapshot at the end of every event batch that changed them. Readers map
+ * the file and copy it under the seqlock (see README), without a request to the X server nor a
+ * system call. This header only uses fixed width types so readers can include it.
+ */
+
+#define SNAPSHOT_MAGIC "kbgwmss1" // Changes with the layout of the file
+#define SNAPSHOT_CLIENTS 256      // The clients after those are left out
+#define SNAPSHOT_TITLE_SIZE 64    // _NET_WM_NAME, or WM_NAME, NUL terminated and truncated
+
+#define SNAPSHOT_FOCUSED 1   // Focused in its workspace
+#define SNAPSHOT_MAXIMIZED 2
+#define SNAPSHOT_TILED 4
+#define SNAPSHOT_HUNG 8
+#define SNAPSHOT_FULLSCREEN 16
+
+typedef struct
+{
+    uint32_t id;
+    int16_t x, y;
+    uint16_t width, height;
+    uint8_t workspace;
+    uint8_t flags; // SNAPSHOT_*
+    uint8_t padding[2];
+    char title[SNAPSHOT_TITLE_SIZE];
+} snapshot_client;
+
+typedef struct
+{
+    uint32_t focused; // Window of the focused client, 0 for none
+    uint8_t current_workspace;
+    uint8_t workspaces_length;
+    uint16_t clients_length;
+    uint64_t occupied; // One bit per workspace holding clients
+    snapshot_client clients[SNAPSHOT_CLIENTS]; // Workspace by workspace, focused client first
+} snapshot_state;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t sequence; // Odd while kbgwm writes state
+    uint32_t padding;
+    snapshot_state state;
+} snapshot_file;
+
+void setup_snapshot();
+bool snapshot_active();
+void snapshot_publish();
+void snapshot_close();
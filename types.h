@@ -22,6 +22,21 @@
 #include <stdint.h>
 #include <xcb/xproto.h>
 
+enum
+{
+    DIRECTION_LEFT,
+    DIRECTION_RIGHT,
+    DIRECTION_UP,
+    DIRECTION_DOWN
+};
+
+enum
+{
+    LAYOUT_FLOATING,
+    LAYOUT_MASTER, // One large tile on the left, the others stacked on the right
+    LAYOUT_GRID
+};
+
 typedef union {
     const bool b;
     const uint_least8_t i;
@@ -36,6 +51,40 @@ typedef struct
     const Arg arg;
 } Key;
 
+/*
+ * Key binding made of up to KEY_CHORD_MAX successive key presses, the unused strokes at the end
+ * have keysym 0
+ */
+#define KEY_CHORD_MAX 3
+
+typedef struct
+{
+    uint16_t modifiers;
+    xcb_keysym_t keysym;
+} Stroke;
+
+typedef struct
+{
+    Stroke strokes[KEY_CHORD_MAX];
+    void (*func)(const Arg *);
+    const Arg arg;
+} Chord;
+
+/*
+ * Rule applied to the windows matching class, instance and role (NULL matches anything)
+ */
+typedef struct
+{
+    const char *class;
+    const char *instance;
+    const char *role;
+    int_least8_t workspace; // -1 for the current workspace
+    int16_t x, y;
+    uint16_t width, height; // 0 keeps the geometry requested by the window
+    bool maximized;
+    bool focus; // false to leave the focus where it is
+} Rule;
+
 typedef struct
 {
     uint16_t modifiers;
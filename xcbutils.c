@@ -17,6 +17,8 @@
  */
 
 #include "xcbutils.h"
+#include "audit.h"
+#include "xerror.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -29,6 +31,7 @@ extern xcb_connection_t *c;
 extern xcb_window_t root;
 extern uint16_t numlockmask;
 extern xcb_atom_t wm_protocols;
+extern uint_least8_t border_width;
 
 void *emalloc(size_t size)
 {
@@ -49,24 +52,29 @@ void *emalloc(size_t size)
  *
  */
 
-void xcb_register_key_events(Key key)
+// Buttons are grabbed on the root window, the click goes to the focused client
+void xcb_register_button_events(Button button)
 {
-    xcb_keycode_t *keycodes;
-    xcb_keycode_t keycode;
+    printf("Registering button press event for button %d / button %d\n", button.modifiers,
+           button.keysym);
 
-    printf("Registering key press event for key %d / key %d\n", key.modifiers, key.keysym);
-
-    keycodes = xcb_get_keycodes(key.keysym);
     uint16_t modifiers[] = {0, numlockmask, XCB_MOD_MASK_LOCK, numlockmask | XCB_MOD_MASK_LOCK};
 
-    for (int i = 0; (keycode = keycodes[i]) != XCB_NO_SYMBOL; i++)
-    {
-        for (int j = 0; j != LENGTH(modifiers); j++)
-            xcb_grab_key(c, 1, root, key.modifiers | modifiers[j], keycode, XCB_GRAB_MODE_ASYNC,
-                         XCB_GRAB_MODE_ASYNC);
-    }
+    for (int j = 0; j != LENGTH(modifiers); j++)
+        XERROR_TRACK(xcb_grab_button(c, 0, root, BUTTON_EVENT_MASK, XCB_GRAB_MODE_ASYNC,
+                                     XCB_GRAB_MODE_ASYNC, XCB_NONE, XCB_NONE, button.keysym,
+                                     button.modifiers | modifiers[j]));
+}
 
-    free(keycodes);
+void xcb_unregister_button_events(Button button)
+{
+    printf("Unregistering button press event for button %d / button %d\n", button.modifiers,
+           button.keysym);
+
+    uint16_t modifiers[] = {0, numlockmask, XCB_MOD_MASK_LOCK, numlockmask | XCB_MOD_MASK_LOCK};
+
+    for (int j = 0; j != LENGTH(modifiers); j++)
+        xcb_ungrab_button(c, button.keysym, root, button.modifiers | modifiers[j]);
 }
 
 /*
@@ -83,7 +91,7 @@ xcb_keycode_t *xcb_get_keycodes(xcb_keysym_t keysym)
         return (NULL);
     }
 
-    xcb_keycode_t *keycode = xcb_key_symbols_get_keycode(keysyms, keysym);
+    xcb_keycode_t *keycode = AUDIT_REPLY(xcb_key_symbols_get_keycode(keysyms, keysym));
 
     xcb_key_symbols_free(keysyms);
     return (keycode);
@@ -103,7 +111,7 @@ xcb_keysym_t xcb_get_keysym(xcb_keycode_t keycode)
         return (0);
     }
 
-    xcb_keysym_t keysym = xcb_key_symbols_get_keysym(keysyms, keycode, 0);
+    xcb_keysym_t keysym = AUDIT_REPLY_VALUE(xcb_key_symbols_get_keysym(keysyms, keycode, 0));
 
     xcb_key_symbols_free(keysyms);
     return (keysym);
@@ -117,7 +125,7 @@ xcb_atom_t xcb_get_atom(const char *atom_name)
     xcb_intern_atom_cookie_t cookie =
         xcb_intern_atom(c, ONLY_IF_EXISTS, strlen(atom_name), atom_name);
 
-    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c, cookie, NULL);
+    xcb_intern_atom_reply_t *reply = AUDIT_REPLY(xcb_intern_atom_reply(c, cookie, NULL));
 
     /* XXX Note that we return 0 as an atom if anything goes wrong.
      * Might become interesting.*/
@@ -140,7 +148,7 @@ bool xcb_send_atom(client *client, xcb_atom_t atom)
 
     // Get the supported atoms for this client
     xcb_icccm_get_wm_protocols_reply_t protocols;
-    if (xcb_icccm_get_wm_protocols_reply(c, cookie, &protocols, NULL) == 1)
+    if (AUDIT_REPLY_VALUE(xcb_icccm_get_wm_protocols_reply(c, cookie, &protocols, NULL)) == 1)
     {
         for (uint_fast32_t i = 0; i < protocols.atoms_len; i++)
         {
@@ -164,6 +172,32 @@ bool xcb_send_atom(client *client, xcb_atom_t atom)
     ev.type = wm_protocols;
     ev.data.data32[0] = atom;
     ev.data.data32[1] = XCB_CURRENT_TIME;
-    xcb_send_event(c, false, client->id, XCB_EVENT_MASK_NO_EVENT, (char *)&ev);
+    XERROR_TRACK(xcb_send_event(c, false, client->id, XCB_EVENT_MASK_NO_EVENT, (char *)&ev));
     return true;
 }
+
+// Tell the client its current geometry, as ICCCM requires when a ConfigureRequest is not applied
+void xcb_send_configure_notify(client *client)
+{
+    assert(client != NULL);
+
+    // Events are always sent as 32 bytes
+    union {
+        xcb_configure_notify_event_t event;
+        char buffer[32];
+    } ev;
+    memset(&ev, 0, sizeof(ev));
+
+    ev.event.response_type = XCB_CONFIGURE_NOTIFY;
+    ev.event.event = client->id;
+    ev.event.window = client->id;
+    ev.event.above_sibling = XCB_NONE;
+    ev.event.x = client->sent_x;
+    ev.event.y = client->sent_y;
+    ev.event.width = client->sent_width;
+    ev.event.height = client->sent_height;
+    ev.event.border_width = client->maximized || client->fullscreen ? 0 : border_width;
+    ev.event.override_redirect = false;
+    XERROR_TRACK(
+        xcb_send_event(c, false, client->id, XCB_EVENT_MASK_STRUCTURE_NOTIFY, ev.buffer));
+}
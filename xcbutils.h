@@ -27,13 +27,16 @@
 #include "types.h"
 
 #define BUTTON_EVENT_MASK XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE
+#define CLIENT_EVENT_MASK                                                                          \
+    XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW | XCB_EVENT_MASK_PROPERTY_CHANGE
 
 void *emalloc(size_t size);
 
 /*
  * registering events
  */
-void xcb_register_key_events(Key key);
+void xcb_register_button_events(Button button);
+void xcb_unregister_button_events(Button button);
 
 xcb_keycode_t *xcb_get_keycodes(xcb_keysym_t);
 xcb_keysym_t xcb_get_keysym(xcb_keycode_t);
@@ -44,6 +47,18 @@ xcb_keysym_t xcb_get_keysym(xcb_keycode_t);
 
 #define WM_DELETE_WINDOW "WM_DELETE_WINDOW"
 #define WM_PROTOCOLS "WM_PROTOCOLS"
+#define WM_WINDOW_ROLE "WM_WINDOW_ROLE"
+#define KBGWM_COMMAND "_KBGWM_COMMAND"
+#define NET_SUPPORTED "_NET_SUPPORTED"
+#define NET_WM_NAME "_NET_WM_NAME"
+#define NET_CLIENT_LIST_STACKING "_NET_CLIENT_LIST_STACKING"
+#define NET_WM_PING "_NET_WM_PING"
+#define NET_WM_STATE "_NET_WM_STATE"
+#define NET_WM_STATE_FULLSCREEN "_NET_WM_STATE_FULLSCREEN"
+#define NET_WM_BYPASS_COMPOSITOR "_NET_WM_BYPASS_COMPOSITOR"
+#define NET_WM_PID "_NET_WM_PID"
+#define WM_CLIENT_MACHINE "WM_CLIENT_MACHINE"
 
 xcb_atom_t xcb_get_atom(const char *);
 bool xcb_send_atom(client *, xcb_atom_t);
+void xcb_send_configure_notify(client *);
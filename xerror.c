@@ -0,0 +1,147 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "xerror.h"
+#include "xcbutils.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define XERROR_RING_SIZE 256 // Power of two, the requests tracked while their error may be pending
+
+typedef struct
+{
+    unsigned int sequence;
+    const char *file;
+    int line;
+} tracked_request;
+
+static tracked_request ring[XERROR_RING_SIZE];
+static uint_fast32_t races = 0;
+static uint_fast32_t reported = 0;
+
+static const char *error_names[] = {
+    [XCB_REQUEST] = "BadRequest",
+    [XCB_VALUE] = "BadValue",
+    [XCB_WINDOW] = "BadWindow",
+    [XCB_PIXMAP] = "BadPixmap",
+    [XCB_ATOM] = "BadAtom",
+    [XCB_CURSOR] = "BadCursor",
+    [XCB_FONT] = "BadFont",
+    [XCB_MATCH] = "BadMatch",
+    [XCB_DRAWABLE] = "BadDrawable",
+    [XCB_ACCESS] = "BadAccess",
+    [XCB_ALLOC] = "BadAlloc",
+    [XCB_COLORMAP] = "BadColormap",
+    [XCB_G_CONTEXT] = "BadGC",
+    [XCB_ID_CHOICE] = "BadIDChoice",
+    [XCB_NAME] = "BadName",
+    [XCB_LENGTH] = "BadLength",
+    [XCB_IMPLEMENTATION] = "BadImplementation",
+};
+
+// The core requests kbgwm issues
+static const char *request_names[] = {
+    [XCB_CREATE_WINDOW] = "CreateWindow",
+    [XCB_CHANGE_WINDOW_ATTRIBUTES] = "ChangeWindowAttributes",
+    [XCB_GET_WINDOW_ATTRIBUTES] = "GetWindowAttributes",
+    [XCB_MAP_WINDOW] = "MapWindow",
+    [XCB_UNMAP_WINDOW] = "UnmapWindow",
+    [XCB_CONFIGURE_WINDOW] = "ConfigureWindow",
+    [XCB_GET_GEOMETRY] = "GetGeometry",
+    [XCB_QUERY_TREE] = "QueryTree",
+    [XCB_INTERN_ATOM] = "InternAtom",
+    [XCB_CHANGE_PROPERTY] = "ChangeProperty",
+    [XCB_GET_PROPERTY] = "GetProperty",
+    [XCB_SEND_EVENT] = "SendEvent",
+    [XCB_GRAB_POINTER] = "GrabPointer",
+    [XCB_UNGRAB_POINTER] = "UngrabPointer",
+    [XCB_GRAB_BUTTON] = "GrabButton",
+    [XCB_UNGRAB_BUTTON] = "UngrabButton",
+    [XCB_GRAB_KEY] = "GrabKey",
+    [XCB_UNGRAB_KEY] = "UngrabKey",
+    [XCB_SET_INPUT_FOCUS] = "SetInputFocus",
+    [XCB_OPEN_FONT] = "OpenFont",
+    [XCB_QUERY_FONT] = "QueryFont",
+    [XCB_CREATE_PIXMAP] = "CreatePixmap",
+    [XCB_FREE_PIXMAP] = "FreePixmap",
+    [XCB_CREATE_GC] = "CreateGC",
+    [XCB_CHANGE_GC] = "ChangeGC",
+    [XCB_COPY_AREA] = "CopyArea",
+    [XCB_POLY_FILL_RECTANGLE] = "PolyFillRectangle",
+    [XCB_IMAGE_TEXT_8] = "ImageText8",
+    [XCB_KILL_CLIENT] = "KillClient",
+};
+
+void xerror_track(unsigned int sequence, const char *file, int line)
+{
+    ring[sequence & (XERROR_RING_SIZE - 1)] = (tracked_request){sequence, file, line};
+}
+
+// The request raced with its window going away, nothing was wrong when it was issued
+static bool xerror_is_race(const xcb_generic_error_t *error)
+{
+    switch (error->error_code)
+    {
+    case XCB_WINDOW:
+    case XCB_DRAWABLE:
+        return true;
+
+    // The window was unmapped or destroyed in the meantime
+    case XCB_MATCH:
+        return error->major_code == XCB_SET_INPUT_FOCUS ||
+               error->major_code == XCB_CONFIGURE_WINDOW;
+
+    default:
+        return false;
+    }
+}
+
+void xerror_handle(xcb_generic_error_t *error)
+{
+    if (xerror_is_race(error))
+    {
+        races++;
+        return; // Nothing else to be done
+    }
+
+    reported++;
+
+    const char *error_name =
+        error->error_code < LENGTH(error_names) ? error_names[error->error_code] : NULL;
+    const char *request_name =
+        error->major_code < LENGTH(request_names) ? request_names[error->major_code] : NULL;
+
+    printf("X error: %s (%d), request %s (%d.%d), resource %#x", error_name ? error_name : "?",
+           error->error_code, request_name ? request_name : "?", error->major_code,
+           error->minor_code, error->resource_id);
+
+    const tracked_request *request = &ring[error->full_sequence & (XERROR_RING_SIZE - 1)];
+    if (request->file != NULL && request->sequence == error->full_sequence)
+        printf(", issued at %s:%d\n", request->file, request->line);
+    else
+        printf(", sequence %u\n", error->full_sequence);
+}
+
+void xerror_summary()
+{
+    printf("xerror: %" PRIuFAST32 " errors reported, %" PRIuFAST32 " races dropped\n", reported,
+           races);
+}
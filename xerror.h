@@ -0,0 +1,36 @@
+/*
+ * kbgwm, a sucklessy floating window manager
+ * Copyright (C) 2020 Kebigon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <xcb/xcb.h>
+
+/*
+ * X error tracking
+ *
+ * Requests that may fail are issued through XERROR_TRACK, which records their sequence number and
+ * call site in a ring. Errors come back as events, they are matched against the ring without ever
+ * waiting for the X server: the races with a window going away (BadWindow, ...) are counted and
+ * dropped, the other errors are reported with the request and the call site that caused them.
+ */
+
+#define XERROR_TRACK(cookie) xerror_track((cookie).sequence, __FILE__, __LINE__)
+
+void xerror_track(unsigned int, const char *, int);
+void xerror_handle(xcb_generic_error_t *);
+void xerror_summary();